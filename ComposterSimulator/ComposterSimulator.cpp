@@ -0,0 +1,371 @@
+/******************************************************************************************************************
+ * ComposterSimulator --- Year-long solar and battery energy simulation of the composter controller
+ *
+ * The simulator compiles the real firmware (ComposterSketch.ino and its modules) against host-side shims of
+ * the Arduino core and libraries, then runs setup() and loop() against a simulated board, solar panel and
+ * 8 AH AGM battery.  A scripted B3 tap on the first day programs the daily autorun exactly as a user would.
+ * A year runs in a few seconds and reports the days without aeration and the minimum state of charge, so
+ * control constants (ARMS, IAMS, MCMS, ...) can be tuned with evidence rather than guesswork.
+ *
+ * Build (from the repository root):
+ *
+ *   g++ -O2 -std=gnu++11 -IComposterSimulator/shim -IComposterSimulator -IComposterSketch \
+ *       ComposterSimulator/[A-Z]*.cpp ComposterSketch/[A-Z]*.cpp -o composterSim
+ *
+ * Evaluate an alternative policy by overriding a constant from Composter.h:
+ *
+ *   g++ ... -DARMS=90000L -DIAMS=15000L -o composterSim
+ *
+ * Usage:  composterSim [--days N] [--start-doy D] [--lat DEG] [--panel W] [--battery AH] [--soc F]
+ *                      [--seed N] [--tap HH:MM] [--usb HH:MM] [--jog HH:MM] [--rtc-ppm P] [--rtc-cal]
+ *                      [--wdt-pct P] [--csv FILE] [--log] [--bench]
+ *
+ * --jog scripts a manual jogging session on the first day:  B1 held for 2 s, six times, 4 s apart.
+ * --rtc-ppm makes the DS1307 run fast (or slow, if negative) by P ppm.  --rtc-cal starts the firmware with
+ * that drift already measured, as SetComposterTime would leave it after syncing at midnight of the first day.
+ * --wdt-pct makes the watchdog's oscillator run fast (or slow, if negative) by P percent, shortening (or
+ * lengthening) every nap.  The datasheet allows it several percent across temperature and supply voltage.
+ * --bench boots into benchmark mode with B1 and B2 held and a USB host plugged in for 10 minutes, presses
+ * B1+B2 again 5 minutes later for the loop() pass figures, and echoes the reports to stderr (as --log does).
+ *
+ * Current draws are estimates:  calibrate the I_* constants against bench measurements of the real unit.
+ *
+ * Note:  On a 64-bit host, long is 64 bits wide, so millis() does not wrap after 49.7 days awake as it
+ * does on the 32U4.  Timer0 stops during naps, so a simulated year rarely gets that far anyway.
+ *
+ ******************************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "SimHost.h"
+#include "Plant.h"
+#include "EEPROM.h"
+#include "avr/power.h"
+
+//The sketch relies on the Arduino IDE's implicit #include and generated prototypes
+#include "Arduino.h"
+void doNap();
+void doStartMotor();
+void doSurplusRun();
+void doLogStart();
+void doBenchmark();
+void doTelemetry(long passMs);
+void intHan();
+
+#include "../ComposterSketch/ComposterSketch.ino"
+
+//Battery current drawn by each load (Amps)
+#define I_BOARD          0.012      //Pro Micro's regulator and power LED
+#define I_CORE_AWAKE     0.023      //32U4 running at 16 MHz.  Scales with the CPU clock.
+#define I_CORE_IDLE      0.003      //32U4 in LowPower.idle() at 16 MHz with peripherals off
+#define I_RELAY          0.075      //Relay coil holding the motor controller powered
+#define I_MC_STANDBY     0.020      //RB-Cyt-133 logic while powered
+#define I_MOTOR_FULL     6.0        //Gear motor at full duty (see Battery.cpp)
+#define I_LED            0.005      //Each indicator LED
+
+//Awake current saved by each peripheral the firmware powers-down (32U4 at 5V/16 MHz, scales with the clock)
+#define I_SAVE_ADC       0.0009
+#define I_SAVE_TWI       0.0006
+#define I_SAVE_SPI       0.0008
+#define I_SAVE_USART1    0.0004
+#define I_SAVE_TIMER     0.0003     //Each of timer1, timer3 and timer4
+#define I_SAVE_USB       0.0040     //USB controller and its PLL
+
+#define LOOP_OVERHEAD_US 50         //CPU time at 16 MHz per loop() pass not charged by the shims
+
+namespace sim {
+
+  struct DayStats {
+    double minSoc, minV, maxV;
+    double motorS, awakeS, highS, lowS, emptyS;
+    double solarAh, loadAh;
+    int runs;
+    bool scheduled;                 //Autorun enabled at some point in the day
+  };
+
+  struct Options {
+    long days;
+    long startDoy;
+    double latitude;
+    double panelW;
+    double batteryAh;
+    double soc;
+    unsigned seed;
+    int tapHour, tapMinute;
+    int usbHour, usbMinute;           //Plug in a USB host for 10 minutes at this time on the first day
+    int jogHour, jogMinute;           //Jog the drum with B1 at this time on the first day
+    double rtcPpm;                    //DS1307 drift
+    bool rtcCal;                      //The firmware knows the drift
+    double wdtPct;                    //Watchdog oscillator error
+    const char *csv;
+    bool bench;                       //Boot into benchmark mode
+  };
+
+  static SolarPanel *panel;
+  static AGMBattery *battery;
+  static std::vector<DayStats> days;
+  static double solarAmps;              //Cached panel current
+  static uint64_t solarUntilUs;         //...valid until this wall time
+  static bool motorWasOn;
+  static bool relayWasOn;
+  static long relayCycles;              //Times the motor controller's relay was energized
+  static double sleepAh, awakeAh, relayAh, motorAh, ledAh;
+  static double fastS, slowS;           //Time awake at 16 MHz and with the CPU clock scaled
+  static long autoruns;                 //Autoruns started by the schedule (not by the B3 tap)
+  static long surplusPulses;            //Extra pulses on an overcharged battery's surplus
+  static unsigned long surplusSeen;     //Stats' count of them when the motor last started
+  static double autorunFirstH = 24.0, autorunLastH, autorunSumH;   //Their times of day
+  static double autorunSumSoc;          //State of charge as they started
+
+  static double terminalVolts;          //Battery voltage at the end of the last observed interval
+
+  static double volts() {
+    return terminalVolts;
+  }
+
+  //Awake current no longer drawn by the peripherals whose clocks are stopped
+  static double peripheralSavings() {
+    double amps = 0.0;
+    if (PRR0 & (1 << PRADC)) amps += I_SAVE_ADC;
+    if (PRR0 & (1 << PRTWI)) amps += I_SAVE_TWI;
+    if (PRR0 & (1 << PRSPI)) amps += I_SAVE_SPI;
+    if (PRR0 & (1 << PRTIM1)) amps += I_SAVE_TIMER;
+    if (PRR1 & (1 << PRTIM3)) amps += I_SAVE_TIMER;
+    if (PRR1 & (1 << PRTIM4)) amps += I_SAVE_TIMER;
+    if (PRR1 & (1 << PRUSART1)) amps += I_SAVE_USART1;
+    if ((PRR1 & (1 << PRUSB)) || !(PLLCSR & (1 << PLLE))) amps += I_SAVE_USB;
+    return amps;
+  }
+
+  //Integrate the plant across an interval during which the board state was constant
+  static void observe(double dtS) {
+    if (board.wallUs >= solarUntilUs) {
+      uint64_t sod = board.wallUs % 86400000000ULL;
+      solarAmps = panel->current(dayNumber(board.wallUs), sod / 3.6e9);
+      solarUntilUs = board.wallUs - sod % 60000000ULL + 60000000ULL;
+    }
+
+    bool relay = board.level[pinMotorPwr];
+    double cpu = I_BOARD + (board.asleep ? I_CORE_IDLE : I_CORE_AWAKE - peripheralSavings()) / clockDiv();
+    double mc = relay ? I_RELAY + I_MC_STANDBY : 0.0;
+    double motor = relay ? I_MOTOR_FULL * board.duty[pinMotorPwm] / 255.0 : 0.0;
+    double leds = I_LED * (board.level[pinSkedLED] + board.level[pinOvrLED] + board.level[pinDisLED]);
+    double load = cpu + mc + motor + leds;
+    battery->step(dtS, solarAmps - load);
+
+    double h = dtS / 3600.0;
+    (board.asleep ? sleepAh : awakeAh) += cpu * h;
+    if (!board.asleep) (clockDiv() == 1 ? fastS : slowS) += dtS;
+    relayAh += mc * h;
+    motorAh += motor * h;
+    ledAh += leds * h;
+
+    double v = terminalVolts = battery->terminalVolts();
+    long d = dayNumber(board.wallUs - 1);
+    if (d >= (long) days.size()) return;
+    DayStats &ds = days[d];
+    double soc = battery->soc();
+    if (soc < ds.minSoc) ds.minSoc = soc;
+    if (v < ds.minV) ds.minV = v;
+    if (v > ds.maxV) ds.maxV = v;
+    if (motor > 0) ds.motorS += dtS;
+    if (!board.asleep) ds.awakeS += dtS;
+    if (v * 10.23 > VMAX) ds.highS += dtS;                //Battery::getVoltage() scaling
+    if (v * 10.23 < VMIN) ds.lowS += dtS;
+    if (soc <= 0.0) ds.emptyS += dtS;
+    ds.solarAh += solarAmps * h;
+    ds.loadAh += load * h;
+    if (EEPROM.mem[EESKEDEN]) ds.scheduled = true;
+    if (motor > 0 && !motorWasOn && Stats::get(STSTARTSURPLUS) != surplusSeen) {
+      surplusSeen = Stats::get(STSTARTSURPLUS);
+      surplusPulses++;                                    //Not aeration the schedule asked for
+    } else if (motor > 0 && !motorWasOn) {
+      ds.runs++;
+      double hod = board.wallUs % 86400000000ULL / 3.6e9;
+      if (::state == ARN && EEPROM.mem[EESKEDEN] && d > 0 && ds.runs == 1) {    //Day 0's run is the tap's
+        autoruns++;
+        autorunSumH += hod;
+        autorunSumSoc += battery->soc();
+        if (hod < autorunFirstH) autorunFirstH = hod;
+        if (hod > autorunLastH) autorunLastH = hod;
+      }
+    }
+    motorWasOn = motor > 0;
+    if (relay && !relayWasOn) relayCycles++;
+    relayWasOn = relay;
+  }
+
+  static void dateString(long day, char *buf) {
+    int y, m, dt, wd;
+    civilDate(day, y, m, dt, wd);
+    sprintf(buf, "%04d-%02d-%02d", y, m, dt);
+  }
+
+  static void usage() {
+    fprintf(stderr, "usage: composterSim [--days N] [--start-doy D] [--lat DEG] [--panel W] [--battery AH]\n"
+                    "                    [--soc F] [--seed N] [--tap HH:MM] [--usb HH:MM] [--jog HH:MM]\n"
+                    "                    [--rtc-ppm P] [--rtc-cal] [--wdt-pct P] [--csv FILE] [--log] [--bench]\n");
+    exit(2);
+  }
+
+  static void parse(int argc, char **argv, Options &o) {
+    for (int i = 1; i < argc; i++) {
+      const char *a = argv[i];
+      const char *v = i + 1 < argc ? argv[i + 1] : 0;
+      if (!strcmp(a, "--log")) { board.logSerial = true; continue; }
+      if (!strcmp(a, "--rtc-cal")) { o.rtcCal = true; continue; }
+      if (!strcmp(a, "--bench")) { o.bench = board.logSerial = true; continue; }
+      if (!v) usage();
+      if (!strcmp(a, "--days")) o.days = atol(v);
+      else if (!strcmp(a, "--start-doy")) o.startDoy = atol(v);
+      else if (!strcmp(a, "--lat")) o.latitude = atof(v);
+      else if (!strcmp(a, "--panel")) o.panelW = atof(v);
+      else if (!strcmp(a, "--battery")) o.batteryAh = atof(v);
+      else if (!strcmp(a, "--soc")) o.soc = atof(v);
+      else if (!strcmp(a, "--seed")) o.seed = (unsigned) atol(v);
+      else if (!strcmp(a, "--tap")) { if (sscanf(v, "%d:%d", &o.tapHour, &o.tapMinute) != 2) usage(); }
+      else if (!strcmp(a, "--usb")) { if (sscanf(v, "%d:%d", &o.usbHour, &o.usbMinute) != 2) usage(); }
+      else if (!strcmp(a, "--jog")) { if (sscanf(v, "%d:%d", &o.jogHour, &o.jogMinute) != 2) usage(); }
+      else if (!strcmp(a, "--rtc-ppm")) o.rtcPpm = atof(v);
+      else if (!strcmp(a, "--wdt-pct")) o.wdtPct = atof(v);
+      else if (!strcmp(a, "--csv")) o.csv = v;
+      else usage();
+      i++;
+    }
+    if (o.days < 1 || o.startDoy < 1 || o.startDoy > 365 || o.batteryAh <= 0 || o.wdtPct <= -50) usage();
+  }
+
+}
+
+using namespace sim;
+
+int main(int argc, char **argv) {
+  Options o = {365, 1, 43.6, 10.0, 8.0, 0.8, 1, 10, 0, -1, 0, -1, 0, 0.0, false, 0.0, 0, false};     //Boise, Idaho
+  parse(argc, argv, o);
+  clock_t c0 = clock();
+
+  //The simulated board starts at midnight of the first simulated day
+  panel = new SolarPanel(o.panelW, o.latitude, o.seed);
+  battery = new AGMBattery(o.batteryAh, o.soc);
+  long first = o.startDoy - 1;
+  board.wallUs = first * 86400000000ULL;
+  DayStats blank = {1.0, 99.0, 0.0, 0, 0, 0, 0, 0, 0, 0, 0, false};
+  days.assign(first + o.days, blank);
+  observer = observe;
+  batteryVolts = volts;
+  terminalVolts = battery->terminalVolts();
+
+  //The DS1307's drift, and what SetComposterTime measured of it
+  rtcPpm = o.rtcPpm;
+  wdtPct = o.wdtPct;
+  if (o.rtcCal) {
+    long syncS = (first - epochDay(2000, 1, 1)) * 86400L;
+    long ppm = lround(o.rtcPpm);
+    EEPROM.put(EERTCSYNC, syncS);
+    EEPROM.put(EERTCPPM, ppm);
+  }
+
+  //Tap B3 at the requested time of day to program the daily autorun
+  uint64_t tap = board.wallUs + (o.tapHour * 3600ULL + o.tapMinute * 60ULL) * 1000000ULL;
+  scheduleInput(tap, pinB3, LOW);
+  scheduleInput(tap + 150000ULL, pinB3, HIGH);
+  if (o.usbHour >= 0) {
+    uint64_t plug = board.wallUs + (o.usbHour * 3600ULL + o.usbMinute * 60ULL) * 1000000ULL;
+    scheduleInput(plug, SIM_VBUS_PIN, HIGH);
+    scheduleInput(plug + 600000000ULL, SIM_VBUS_PIN, LOW);
+  }
+  if (o.jogHour >= 0) {
+    uint64_t jog = board.wallUs + (o.jogHour * 3600ULL + o.jogMinute * 60ULL) * 1000000ULL;
+    for (int i = 0; i < 6; i++, jog += 6000000ULL) {
+      scheduleInput(jog, pinB1, LOW);
+      scheduleInput(jog + 2000000ULL, pinB1, HIGH);
+    }
+  }
+
+  if (o.bench) {
+    board.input[pinB1] = board.input[pinB2] = LOW;    //Held as the board resets
+    scheduleInput(board.wallUs + 4000000ULL, pinB1, HIGH);
+    scheduleInput(board.wallUs + 4000000ULL, pinB2, HIGH);
+    scheduleInput(board.wallUs, SIM_VBUS_PIN, HIGH);
+    scheduleInput(board.wallUs + 600000000ULL, SIM_VBUS_PIN, LOW);
+    for (uint8_t pin = pinB1; pin <= pinB2; pin++) {
+      scheduleInput(board.wallUs + 300000000ULL, pin, LOW);
+      scheduleInput(board.wallUs + 301000000ULL, pin, HIGH);
+    }
+  }
+
+  //Run the firmware
+  uint64_t endUs = (first + o.days) * 86400000000ULL;
+  setup();
+  uint64_t bootUs = board.wallUs - first * 86400000000ULL;
+  while (board.wallUs < endUs) {
+    loop();
+    compute(LOOP_OVERHEAD_US);
+  }
+
+  //Summarize
+  FILE *csv = o.csv ? fopen(o.csv, "w") : 0;
+  if (o.csv && !csv) { perror(o.csv); return 1; }
+  if (csv) fprintf(csv, "date,min_soc,min_v,max_v,runs,motor_s,awake_s,high_h,low_h,empty_h,solar_ah,load_ah\n");
+  int aerated = 0, missed = 0;
+  long firstMiss = -1, minDay = first;
+  double minSoc = 1.0, minV = 99.0, maxV = 0.0, highH = 0.0, lowH = 0.0, emptyH = 0.0, solarAh = 0.0;
+  char date[16];
+  for (long d = first; d < (long) days.size(); d++) {
+    DayStats &ds = days[d];
+    if (ds.runs > 0) aerated++;
+    else if (ds.scheduled) { missed++; if (firstMiss < 0) firstMiss = d; }
+    if (ds.minSoc < minSoc) { minSoc = ds.minSoc; minDay = d; }
+    if (ds.minV < minV) minV = ds.minV;
+    if (ds.maxV > maxV) maxV = ds.maxV;
+    highH += ds.highS / 3600.0;
+    lowH += ds.lowS / 3600.0;
+    emptyH += ds.emptyS / 3600.0;
+    solarAh += ds.solarAh;
+    if (csv) {
+      dateString(d, date);
+      fprintf(csv, "%s,%.3f,%.2f,%.2f,%d,%.0f,%.0f,%.2f,%.2f,%.2f,%.3f,%.3f\n", date, ds.minSoc, ds.minV,
+              ds.maxV, ds.runs, ds.motorS, ds.awakeS, ds.highS / 3600.0, ds.lowS / 3600.0, ds.emptyS / 3600.0,
+              ds.solarAh, ds.loadAh);
+    }
+  }
+  if (csv) fclose(csv);
+
+  dateString(first, date);
+  printf("Composter simulation:  %ld days from %s, latitude %.1f, %.0f W panel, %.1f AH battery, seed %u\n",
+         o.days, date, o.latitude, o.panelW, o.batteryAh, o.seed);
+  printf("Firmware:  ARMS=%ld ms  IAMS=%ld ms  MCMS=%ld ms\n", (long) ARMS, (long) IAMS, (long) MCMS);
+  printf("Autorun programmed at %02d:%02d on the first day\n", o.tapHour, o.tapMinute);
+  printf("Reset to loop():  %.1f ms\n\n", bootUs / 1000.0);
+  printf("Days aerated / missed:        %d / %d", aerated, missed);
+  if (firstMiss >= 0) { dateString(firstMiss, date); printf("  (first miss %s)", date); }
+  dateString(minDay, date);
+  printf("\nMinimum state of charge:      %.1f%% on %s\n", minSoc * 100.0, date);
+  printf("Terminal voltage min / max:   %.2f / %.2f V\n", minV, maxV);
+  printf("Hours isHigh / isLow / empty: %.1f / %.1f / %.1f\n", highH, lowH, emptyH);
+  printf("Solar in / wasted:            %.2f / %.2f AH\n", solarAh, battery->wastedAh);
+  printf("Load sleep / awake:           %.2f / %.2f AH\n", sleepAh, awakeAh);
+  printf("Hours awake at 16 / 2 MHz:    %.1f / %.1f\n", fastS / 3600.0, slowS / 3600.0);
+  printf("Load relay+ctl / motor / LED: %.2f / %.2f / %.2f AH\n", relayAh, motorAh, ledAh);
+  printf("Naps / dozes / EEPROM writes: %ld / %ld / %ld\n", board.naps, board.dozes, board.eepromWrites);
+  printf("Scheduled task overruns:      %u\n", tasks.getOverruns());
+  printf("Stats wakes WDT / button, refused starts, missed days:  %lu / %lu, %lu, %lu\n",
+         Stats::get(STWAKEWDT), Stats::get(STWAKEBUTTON), Stats::get(STREFUSED), Stats::get(STMISSED));
+  StandbyPolicy &sp = motor.getStandby();
+  if (autoruns) {
+    printf("Autorun time earliest / mean / latest:  %02d:%02d / %02d:%02d / %02d:%02d\n",
+           (int) autorunFirstH, (int) (autorunFirstH * 60) % 60, (int) (autorunSumH / autoruns),
+           (int) (autorunSumH / autoruns * 60) % 60, (int) autorunLastH, (int) (autorunLastH * 60) % 60);
+    printf("Autorun state of charge mean: %.1f%%\n", autorunSumSoc / autoruns * 100.0);
+  }
+  printf("Surplus pulses / motor time:  %ld / %.1f min\n", surplusPulses,
+         surplusPulses * (ARMS / AUTOPULSES) / 60000.0);
+  printf("Relay cycles / standby hits / misses / hold: %ld / %u / %u / %ld ms\n", relayCycles, sp.getHits(),
+         sp.getMisses(), sp.getHoldMs());
+  printf("Simulated in %.1f s\n", (clock() - c0) / (double) CLOCKS_PER_SEC);
+  return 0;
+}
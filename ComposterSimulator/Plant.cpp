@@ -0,0 +1,96 @@
+/******************************************************************************************************************
+ * Plant.cpp --- Solar panel and AGM battery models for the composter simulator
+ *
+ * Panel:    Fixed panel facing south, tilted at the site's latitude, charging the battery directly (no MPPT)
+ *           at roughly its short-circuit current.  Clear-sky beam irradiance follows Meinel's air-mass
+ *           attenuation; each day draws a weather factor whose overcast probability peaks in mid-winter.
+ * Battery:  Open-circuit voltage rises with state of charge and falls off steeply when nearly empty.  Terminal
+ *           voltage adds the I*R drop and, while charging, a knee that drives the voltage toward gassing as
+ *           the battery approaches full.  Charge it cannot accept is counted as wasted.
+ *
+ ******************************************************************************************************************/
+
+#include <math.h>
+#include "Plant.h"
+
+#define PANEL_VMP         17.5      //Volts at maximum power for a nominal 12V panel
+#define SOLAR_CONSTANT    1353.0    //W/m^2 above the atmosphere
+#define DIFFUSE_FRACTION  0.10      //Diffuse sky irradiance as a fraction of beam
+
+#define AGM_RINT          0.020     //Ohms, 8AH AGM internal resistance
+#define AGM_OCV_EMPTY     11.6      //Volts at rest near 0% (before the steep fall-off)
+#define AGM_OCV_SPAN      1.25      //Volts between empty and full at rest
+#define AGM_COLLAPSE      1.5       //Volts lost as the last few percent of charge is drawn
+#define AGM_COLLAPSE_SOC  0.04      //State-of-charge width of the collapse
+#define AGM_KNEE_VOLTS    1.6       //Charging overvoltage at 100% (about 14.4V absorption)
+#define AGM_KNEE_WIDTH    0.015     //State-of-charge width of the charging knee
+#define AGM_CHARGE_EFF    0.95      //Coulombic efficiency while charging
+#define AGM_SELF_DISCHG   0.03      //Fraction of capacity lost per 30 days
+
+static const double PI = 3.14159265358979;
+
+SolarPanel::SolarPanel(double w, double latitudeDeg, unsigned s) {
+  watts = w;
+  latitude = latitudeDeg * PI / 180.0;
+  seed = s;
+}
+
+//Deterministic per-day random number in 0..1
+static double dayRandom(unsigned seed, long day, unsigned salt) {
+  unsigned long x = (unsigned long) day * 2654435761UL ^ seed * 40503UL ^ salt * 97UL;
+  x ^= x >> 13; x *= 0x5bd1e995UL; x ^= x >> 15;
+  return (x & 0xffffff) / (double) 0x1000000;
+}
+
+double SolarPanel::weather(long day) {
+  double doy = day % 365;
+  double pOvercast = 0.25 + 0.35 * cos(2 * PI * (doy - 15) / 365.0);   //About 60% in January, nil in July
+  double r = dayRandom(seed, day, 2);
+  return dayRandom(seed, day, 1) < pOvercast ? 0.10 + 0.25 * r : 0.70 + 0.30 * r;
+}
+
+double SolarPanel::current(long day, double hourOfDay) {
+  double doy = day % 365 + 1;
+  double dec = 23.44 * PI / 180.0 * sin(2 * PI * (284 + doy) / 365.0);
+  double h = (hourOfDay - 12.0) * 15.0 * PI / 180.0;
+  double sinEl = sin(latitude) * sin(dec) + cos(latitude) * cos(dec) * cos(h);
+  if (sinEl <= 0.0) return 0.0;                                      //Sun is down
+  double am = sinEl < 0.026 ? 38.0 : 1.0 / sinEl;                   //Air mass
+  double beam = SOLAR_CONSTANT * pow(0.7, pow(am, 0.678));
+  double cosInc = cos(dec) * cos(h);                                 //Panel tilted at latitude
+  double g = beam * ((cosInc > 0 ? cosInc : 0) + DIFFUSE_FRACTION) * weather(day);
+  return watts / PANEL_VMP * g / 1000.0;
+}
+
+
+AGMBattery::AGMBattery(double ah, double initialSoc) {
+  capacityAh = ah;
+  chargeAh = ah * initialSoc;
+  amps = 0;
+  wastedAh = 0;
+}
+
+void AGMBattery::step(double dtS, double a) {
+  amps = a;
+  double dAh = a * dtS / 3600.0;
+  if (dAh > 0) dAh *= AGM_CHARGE_EFF;
+  dAh -= capacityAh * AGM_SELF_DISCHG * dtS / (30 * 86400.0);
+  chargeAh += dAh;
+  if (chargeAh > capacityAh) {
+    wastedAh += chargeAh - capacityAh;
+    chargeAh = capacityAh;
+  }
+  if (chargeAh < 0) chargeAh = 0;
+}
+
+double AGMBattery::soc() {
+  return chargeAh / capacityAh;
+}
+
+double AGMBattery::terminalVolts() {
+  double s = soc();
+  double v = AGM_OCV_EMPTY + AGM_OCV_SPAN * s - AGM_COLLAPSE * exp(-s / AGM_COLLAPSE_SOC);
+  v += amps * AGM_RINT;
+  if (amps > 0) v += AGM_KNEE_VOLTS * exp((s - 1.0) / AGM_KNEE_WIDTH);
+  return v;
+}
@@ -0,0 +1,37 @@
+/**
+ * Plant.h --- Physical models of the composter's solar panel, storage battery and electrical loads
+ *
+ * The models are deliberately simple.  The constants in Plant.cpp are estimates taken from the parts'
+ * data sheets; calibrate them against a bench measurement before trusting small differences.
+ */
+
+#ifndef PLANT_H_
+#define PLANT_H_
+
+//A small fixed-tilt panel with daily and seasonal irradiance and day-to-day weather
+class SolarPanel {
+public:
+  SolarPanel(double watts, double latitudeDeg, unsigned seed);
+  double current(long day, double hourOfDay);     //Charging current (A) into the battery
+  double weather(long day);                        //That day's clear-sky fraction (0..1)
+private:
+  double watts;
+  double latitude;                                 //Radians
+  unsigned seed;
+};
+
+//A 12V AGM lead-acid battery with internal resistance and a charge-acceptance knee near full
+class AGMBattery {
+public:
+  AGMBattery(double capacityAh, double initialSoc);
+  void step(double dtS, double amps);              //Integrate a net current (A, + charges) for dtS seconds
+  double terminalVolts();                          //Voltage at the terminals under the last current
+  double soc();                                    //State of charge (0..1)
+  double wastedAh;                                 //Charge the full battery could not accept
+private:
+  double capacityAh;
+  double chargeAh;
+  double amps;                                     //Most recent net current
+};
+
+#endif /* PLANT_H_ */
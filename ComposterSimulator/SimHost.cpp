@@ -0,0 +1,475 @@
+/******************************************************************************************************************
+ * SimHost.cpp --- The simulated Arduino Pro Micro board
+ *
+ * Implements the shim APIs (Arduino core, LowPower, EEPROM, DS1307) on top of the simulator's clocks.
+ * The time charged to each operation approximates the real 32U4, following its prescalers:
+ *
+ *  analogRead()        13 ADC clocks, about 112 us at the Arduino core's 125 kHz
+ *  DS1307 transfer     About 100 SCL bits, about 1 ms at Wire's 100 kHz
+ *  EEPROM cell write   3.3 ms per changed cell (timed by its own RC oscillator)
+ *
+ * The shims fault when the firmware leaves a peripheral unusable:  powered-down, or (after scaling the CPU
+ * clock) producing the wrong tone pitch or PWM frequency, or servicing USB below 16 MHz.
+ *
+ ******************************************************************************************************************/
+
+#include <stdio.h>
+#include <ctype.h>
+#include <algorithm>
+#include <vector>
+
+#include "Arduino.h"
+#include "LowPower.h"
+#include "EEPROM.h"
+#include "Wire.h"
+#include "SparkFunDS1307RTC.h"
+#include "avr/power.h"
+#include "SimHost.h"
+
+#define ADC_CLOCKS      13L
+#define ADC_SETUP_US    8L
+#define I2C_XFER_BITS   100L
+#define EEPROM_CELL_US  3300L
+#define TIMER0_OVF_US   1024ULL        //timer0 overflow period (16 MHz / 64 / 256)
+#define MAX_BATCH_US    1000000ULL     //Longest interval reported to the observer in one piece
+
+namespace sim {
+
+  Board board;
+  Observer observer = 0;
+  VoltageSource batteryVolts = 0;
+  int epochYear = 2026;
+  double rtcPpm = 0.0;
+  double wdtPct = 0.0;
+
+  struct InputEvent {
+    uint64_t wallUs;
+    uint8_t pin;
+    uint8_t level;
+    bool operator<(const InputEvent &x) const { return wallUs < x.wallUs; }
+  };
+  static std::vector<InputEvent> inputs;    //Pending scripted transitions, sorted by time
+  static size_t nextInput = 0;
+  static bool timer0Frozen = false;
+  static uint64_t timer3Cycles = 0;         //CPU cycles clocked into timer3 while it was powered
+  static void (*pinChange[SIM_NUM_PINS])();  //Handlers given to attachInterrupt() (always CHANGE here)
+
+  void scheduleInput(uint64_t wallUs, uint8_t pin, uint8_t level) {
+    InputEvent e = {wallUs, pin, level};
+    inputs.insert(std::upper_bound(inputs.begin() + nextInput, inputs.end(), e), e);
+  }
+
+  uint64_t nextInputTime() {
+    return nextInput < inputs.size() ? inputs[nextInput].wallUs : UINT64_MAX;
+  }
+
+  //Apply the scripted transitions that have come due
+  static void applyInputs() {
+    while (nextInput < inputs.size() && inputs[nextInput].wallUs <= board.wallUs) {
+      uint8_t pin = inputs[nextInput].pin;
+      bool changed = board.input[pin] != inputs[nextInput].level;
+      board.input[pin] = inputs[nextInput].level;
+      if (changed && pinChange[pin] && (SREG & 0x80)) pinChange[pin]();
+      if (inputs[nextInput].pin == SIM_VBUS_PIN) board.usbHost = inputs[nextInput].level;
+      nextInput++;
+    }
+  }
+
+  //Report the time accumulated since the board state last changed.  Batching the many tiny
+  //intervals of a loop() pass keeps a simulated year down to seconds.
+  static uint64_t pendingUs = 0;
+  static void flush() {
+    if (pendingUs && observer) observer(pendingUs / 1e6);
+    pendingUs = 0;
+  }
+
+  void fault(const char *what) {
+    fprintf(stderr, "composterSim: %s at %.3f s\n", what, board.wallUs / 1e6);
+    exit(3);
+  }
+
+  //timer0 ticks at 16 MHz / 64 unless the CPU clock and its prescaler don't match
+  static unsigned timer0Ticks() {
+    static const unsigned prescale[] = {0, 1, 8, 64, 256, 1024, 0, 0};
+    return clockDiv() * prescale[TCCR0B & 0x07];
+  }
+
+  //timer1 overflows every 510 ticks in the Arduino core's 8-bit phase-correct PWM mode (2040 us at 16 MHz / 64)
+  static unsigned timer1OverflowUs() {
+    static const unsigned prescale[] = {0, 1, 8, 64, 256, 1024, 0, 0};
+    if (PRR0 & (1 << PRTIM1)) return 0;
+    return 510 * clockDiv() * prescale[TCCR1B & 0x07] / 16;
+  }
+
+  static void pass(uint64_t us) {
+    board.wallUs += us;
+    if (!timer0Frozen) {
+      unsigned ticks = timer0Ticks();
+      if (ticks) board.timer0Us += ticks == 64 ? us : us * 64 / ticks;
+    }
+    if (!(PRR1 & (1 << PRTIM3))) timer3Cycles += us * 16 / clockDiv();
+    pendingUs += us;
+    if (pendingUs >= MAX_BATCH_US) flush();
+    applyInputs();
+  }
+
+  //Let time pass, taking timer1's overflow interrupt wherever it falls
+  static uint64_t timer1Us = 0;         //Time since timer1 last overflowed
+  void advance(uint64_t us) {
+    unsigned period = timer1OverflowUs();
+    if (!period) {
+      pass(us);
+      return;
+    }
+    while (timer1Us + us >= period) {
+      uint64_t step = period - timer1Us;
+      pass(step);
+      us -= step;
+      timer1Us = 0;
+      if ((TIMSK1 & (1 << TOIE1)) && (SREG & 0x80) && TIMER1_OVF_vect) TIMER1_OVF_vect();
+      period = timer1OverflowUs();
+      if (!period) break;
+    }
+    timer1Us += us;
+    pass(us);
+  }
+
+  void compute(uint64_t us) {
+    advance(us * clockDiv());
+  }
+
+  void sleepFor(uint64_t us, bool timer0Off) {
+    uint64_t wake = board.wallUs + us;
+    uint64_t interrupt = nextInputTime();       //Buttons are on CHANGE interrupts
+    if (interrupt < wake) wake = interrupt > board.wallUs ? interrupt : board.wallUs;
+    flush();
+    board.asleep = true;
+    timer0Frozen = timer0Off;
+    advance(wake - board.wallUs);
+    flush();
+    timer0Frozen = false;
+    board.asleep = false;
+    if (timer0Off) board.naps++;
+    else board.dozes++;
+  }
+
+  long dayNumber(uint64_t wallUs) {
+    return (long) (wallUs / 86400000000ULL);
+  }
+
+  //Days since 1970-01-01 for a proleptic Gregorian date (H. Hinnant's days_from_civil)
+  static long daysFromCivil(int y, int m, int d) {
+    y -= m <= 2;
+    long era = (y >= 0 ? y : y - 399) / 400;
+    long yoe = y - era * 400;
+    long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+  }
+
+  long epochDay(int year, int month, int date) {
+    return daysFromCivil(year, month, date) - daysFromCivil(epochYear, 1, 1);
+  }
+
+  void civilDate(long day, int &year, int &month, int &date, int &weekday) {
+    long z = daysFromCivil(epochYear, 1, 1) + day;
+    weekday = (int) ((z % 7 + 11) % 7) + 1;     //1970-01-01 was a Thursday; DS1307 Sunday==1
+    z += 719468;
+    long era = (z >= 0 ? z : z - 146096) / 146097;
+    long doe = z - era * 146097;
+    long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long mp = (5 * doy + 2) / 153;
+    date = (int) (doy - (153 * mp + 2) / 5 + 1);
+    month = (int) (mp < 10 ? mp + 3 : mp - 9);
+    year = (int) (yoe + era * 400 + (month <= 2));
+  }
+
+}
+
+using sim::board;
+
+volatile uint8_t PRR0;
+volatile uint8_t PRR1;
+volatile uint8_t SREG = 0x80;
+volatile uint8_t TCCR0B = (1 << CS01) | (1 << CS00);  //As left by the Arduino core's init()
+volatile uint8_t TCCR1B = (1 << CS11) | (1 << CS10);
+volatile uint8_t TIMSK1;
+volatile uint8_t TIFR1;
+volatile uint8_t TCCR3A = (1 << WGM30);               //8-bit phase-correct PWM, as left by init()...
+volatile uint8_t TCCR3B = (1 << CS31) | (1 << CS30);  //...at prescale /64
+volatile uint8_t TIMSK3;
+volatile uint8_t TIFR3;
+volatile uint16_t OCR3B;
+SimTcnt3 TCNT3;
+static uint64_t timer3ZeroCycles;                     //timer3Cycles when TCNT3 was last zero
+volatile uint8_t ADCSRA = (1 << ADEN) | 7;
+volatile uint8_t TWBR = 72;                           //As left by Wire.begin()
+volatile uint8_t USBCON = (1 << USBE) | (1 << OTGPADE);
+volatile uint8_t PLLCSR = (1 << PLLE) | (1 << PLOCK);  //The shim's PLL locks at once, so PLOCK always reads set
+volatile uint8_t UDCON;                               //Attached by the Arduino core at reset
+
+uint8_t sim_usbsta() {
+  return board.usbHost && (USBCON & (1 << OTGPADE)) ? 1 << VBUS : 0;
+}
+
+void clock_prescale_set(clock_div_t div) {
+  sim::flush();
+  board.clockShift = (uint8_t) div;
+}
+
+//timer0's count within its overflow period
+uint8_t sim_tcnt0() {
+  return (uint8_t) (board.timer0Us % TIMER0_OVF_US * 256 / TIMER0_OVF_US);
+}
+
+static unsigned timer3Prescale() {
+  static const unsigned prescale[] = {0, 1, 8, 64, 256, 1024, 0, 0};
+  return prescale[TCCR3B & 0x07];
+}
+
+SimTcnt3::operator uint16_t() const {
+  unsigned p = timer3Prescale();
+  return p ? (uint16_t) ((sim::timer3Cycles - timer3ZeroCycles) / p) : 0;
+}
+
+SimTcnt3 &SimTcnt3::operator=(uint16_t count) {
+  timer3ZeroCycles = sim::timer3Cycles - (uint64_t) count * timer3Prescale();
+  return *this;
+}
+
+clock_div_t clock_prescale_get() {
+  return (clock_div_t) board.clockShift;
+}
+
+//The host has enumerated us and opened the port half a second after we attach
+static bool usbConnected() {
+  return board.usbHost && (PLLCSR & (1 << PLLE)) && !(USBCON & (1 << FRZCLK)) && !(UDCON & (1 << DETACH)) &&
+         !(PRR1 & (1 << PRUSB)) &&
+         board.wallUs - board.usbAttachUs >= 500000ULL;
+}
+
+
+//------------------------------------------------------------------------------------------------------
+//  Arduino core
+//------------------------------------------------------------------------------------------------------
+
+unsigned long millis() { return (unsigned long) (board.timer0Us / 1000); }
+unsigned long micros() { return (unsigned long) board.timer0Us; }
+void delay(unsigned long ms) { sim::advance(ms * 1000ULL); }
+void delayMicroseconds(unsigned int us) { sim::advance(us); }
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (mode == INPUT_PULLUP) board.input[pin] = HIGH;
+}
+
+int digitalRead(uint8_t pin) {
+  return board.input[pin];
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  if (board.level[pin] != (level ? HIGH : LOW) || board.duty[pin] != (level ? 255 : 0)) sim::flush();
+  board.level[pin] = level ? HIGH : LOW;
+  board.duty[pin] = level ? 255 : 0;
+}
+
+int analogRead(uint8_t pin) {
+  if ((PRR0 & (1 << PRADC)) || !(ADCSRA & (1 << ADEN))) sim::fault("analogRead() with the ADC powered-down");
+  unsigned long adcHz = F_CPU / sim::clockDiv() / (1L << ((ADCSRA & 0x07) ? (ADCSRA & 0x07) : 1));
+  if (adcHz > 200000L) sim::fault("analogRead() with the ADC clock above 200 kHz");
+  sim::advance(ADC_SETUP_US + ADC_CLOCKS * 1000000L / adcHz);
+  double v = (pin == A0 && sim::batteryVolts) ? sim::batteryVolts() / 10.0 : 0.0;  //Divide-by-10 network
+  int count = (int) (v / 5.0 * 1023.0 + 0.5);
+  return count > 1023 ? 1023 : count;
+}
+
+void analogWrite(uint8_t pin, int duty) {
+  duty = duty < 0 ? 0 : duty > 255 ? 255 : duty;
+  if (duty > 0 && duty < 255 && pin == 9) {
+    static const unsigned prescale[] = {0, 1, 8, 64, 256, 1024, 0, 0};
+    if (PRR0 & (1 << PRTIM1)) sim::fault("PWM on pin 9 with timer1 powered-down");
+    if (sim::clockDiv() * prescale[TCCR1B & 0x07] != 64) sim::fault("PWM on pin 9 away from 490 Hz");
+  }
+  if (board.duty[pin] != duty) sim::flush();
+  board.duty[pin] = (uint8_t) duty;
+  board.level[pin] = board.duty[pin] ? HIGH : LOW;
+}
+
+void tone(uint8_t, unsigned int, unsigned long) {
+  if (PRR1 & (1 << PRTIM3)) sim::fault("tone() with timer3 powered-down");
+  if (sim::clockDiv() != 1) sim::fault("tone() off-pitch with the CPU clock scaled");
+}
+
+void noTone(uint8_t) {}
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int) { sim::pinChange[interrupt] = handler; }
+void detachInterrupt(uint8_t interrupt) { sim::pinChange[interrupt] = 0; }
+
+
+String::String(double d, int places) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", places, d);
+  s = buf;
+}
+
+std::string String::fmt(long n, int base) {
+  if (n < 0 && base == DEC) return "-" + fmt((unsigned long) -n, base);
+  return fmt((unsigned long) n, base);
+}
+
+std::string String::fmt(unsigned long n, int base) {
+  char buf[40];
+  snprintf(buf, sizeof(buf), base == HEX ? "%lX" : "%lu", n);
+  return buf;
+}
+
+
+SerialShim Serial;
+
+SerialShim::operator bool() const { return usbConnected(); }
+
+int SerialShim::available() { return (int) board.serialIn.size(); }
+
+int SerialShim::read() {
+  if (board.serialIn.empty()) return -1;
+  int c = (uint8_t) board.serialIn[0];
+  board.serialIn.erase(0, 1);
+  return c;
+}
+
+size_t SerialShim::write(uint8_t b) { return write(&b, 1); }
+
+size_t SerialShim::write(const uint8_t *buf, size_t n) {
+  if (!usbConnected()) return 0;                  //Nobody is listening
+  if (sim::clockDiv() != 1) sim::fault("USB serviced with the CPU clock scaled");
+  if (board.logSerial) fwrite(buf, 1, n, stderr);
+  return n;
+}
+
+size_t SerialShim::print(const String &x) {
+  return write((const uint8_t *) x.c_str(), x.length());
+}
+
+long SerialShim::parseInt() {
+  while (!board.serialIn.empty() && !isdigit((unsigned char) board.serialIn[0]) && board.serialIn[0] != '-')
+    board.serialIn.erase(0, 1);
+  return board.serialIn.empty() ? 0 : strtol(board.serialIn.c_str(), 0, 10);
+}
+
+
+//------------------------------------------------------------------------------------------------------
+//  Libraries
+//------------------------------------------------------------------------------------------------------
+
+LowPowerClass LowPower;
+
+static uint64_t periodUs(period_t p) {
+  static const uint32_t ms[] = {15, 30, 60, 120, 250, 500, 1000, 2000, 4000, 8000};
+  return p == SLEEP_FOREVER ? UINT64_MAX / 2 : (uint64_t) (ms[p] * 1000.0 / (1.0 + sim::wdtPct / 100.0));
+}
+
+//Like the real library, idle() powers-down the peripherals it is told to turn off and powers them
+//all back up when it wakes, whatever their state beforehand.
+void LowPowerClass::idle(period_t period, adc_t adc, timer4_t timer4, timer3_t timer3, timer1_t timer1,
+                         timer0_t timer0, spi_t spi, usart1_t usart1, twi_t twi, usb_t usb) {
+  uint8_t prr0 = (timer1 == TIMER1_OFF ? 1 << PRTIM1 : 0) | (timer0 == TIMER0_OFF ? 1 << PRTIM0 : 0) |
+                 (spi == SPI_OFF ? 1 << PRSPI : 0) | (twi == TWI_OFF ? 1 << PRTWI : 0);
+  uint8_t prr1 = (timer4 == TIMER4_OFF ? 1 << PRTIM4 : 0) | (timer3 == TIMER3_OFF ? 1 << PRTIM3 : 0) |
+                 (usart1 == USART1_OFF ? 1 << PRUSART1 : 0) | (usb == USB_OFF ? 1 << PRUSB : 0);
+  if (adc == ADC_OFF) ADCSRA &= ~(1 << ADEN);
+  PRR0 |= prr0;
+  PRR1 |= prr1;
+  uint64_t us = periodUs(period);
+  uint64_t ovf = TIMER0_OVF_US - board.timer0Us % TIMER0_OVF_US;
+  if (timer0 == TIMER0_ON && us > ovf) us = ovf;  //timer0's next overflow interrupt wakes us
+  uint64_t match = UINT64_MAX;                      //...as does timer3's compare match B
+  if ((TIMSK3 & (1 << OCIE3B)) && !(PRR1 & (1 << PRTIM3)) && timer3Prescale()) {
+    uint64_t ticks = (uint16_t) (OCR3B - TCNT3 - 1) + 1ULL;
+    match = (ticks * timer3Prescale() * sim::clockDiv() + 15) / 16;
+    if (us > match) us = match;
+  }
+  uint64_t slept = board.wallUs;
+  sim::sleepFor(us, timer0 == TIMER0_OFF);
+  if (board.wallUs - slept >= match && (SREG & 0x80) && TIMER3_COMPB_vect) TIMER3_COMPB_vect();
+  PRR0 &= ~prr0;
+  PRR1 &= ~prr1;
+  if (adc == ADC_OFF) ADCSRA |= (1 << ADEN);
+}
+
+void LowPowerClass::powerDown(period_t period, adc_t, bod_t) {
+  sim::sleepFor(periodUs(period), true);
+}
+
+
+EEPROMClass EEPROM;
+
+void EEPROMClass::write(int address, uint8_t value) {
+  mem[address] = value;
+  board.eepromWrites++;
+  sim::advance(EEPROM_CELL_US);
+}
+
+
+TwoWire Wire;
+
+//Time taken by an I2C transfer at the current SCL frequency
+static uint64_t i2cXferUs() {
+  unsigned long sclHz = F_CPU / sim::clockDiv() / (16 + 2 * TWBR);
+  return I2C_XFER_BITS * 1000000ULL / sclHz;
+}
+
+
+USBDeviceShim USBDevice;
+
+//Like the core's attach(), this (re)starts the PLL, unfreezes the clock and attaches to the bus
+void USBDeviceShim::attach() {
+  if (UDCON & (1 << DETACH)) board.usbAttachUs = board.wallUs;
+  PLLCSR |= (1 << PLLE);
+  USBCON = (1 << USBE) | (1 << OTGPADE);
+  UDCON &= ~(1 << DETACH);
+}
+
+//Like the core's detach(), this only drops off the bus.  The clock and the PLL keep running.
+void USBDeviceShim::detach() {
+  UDCON |= (1 << DETACH);
+}
+
+bool USBDeviceShim::configured() { return usbConnected(); }
+
+
+DS1307 rtc;
+
+//Seconds counted by the DS1307's crystal since the simulation began
+static long long rtcTicks() {
+  return (long long) (board.wallUs / 1e6 * (1.0 + sim::rtcPpm / 1e6));
+}
+
+void DS1307::begin() {
+  update();
+}
+
+bool DS1307::update() {
+  if (PRR0 & (1 << PRTWI)) sim::fault("I2C transfer with TWI powered-down");
+  sim::advance(i2cXferUs());
+  long long t = rtcTicks() + offsetS;
+  long day = (long) (t / 86400);
+  long sod = (long) (t % 86400);
+  static long cachedDay = -1;
+  static int y, m, d, wd;
+  if (day != cachedDay) sim::civilDate(cachedDay = day, y, m, d, wd);
+  second = sod % 60;
+  minute = (sod / 60) % 60;
+  hour = sod / 3600;
+  this->day = wd;
+  date = d;
+  month = m;
+  year = y % 100;
+  return true;
+}
+
+bool DS1307::setTime(uint8_t sec, uint8_t min, uint8_t hr, uint8_t, uint8_t dt, uint8_t mon, uint8_t yr) {
+  if (PRR0 & (1 << PRTWI)) sim::fault("I2C transfer with TWI powered-down");
+  sim::advance(i2cXferUs());
+  long day = sim::epochDay(2000 + yr, mon, dt);
+  offsetS = day * 86400LL + hr * 3600L + min * 60L + sec - rtcTicks();
+  return update();
+}
@@ -0,0 +1,77 @@
+/**
+ * SimHost.h --- The simulated Arduino Pro Micro board on which the composter firmware runs
+ *
+ * The shim headers (shim/Arduino.h, shim/LowPower.h, ...) route every hardware access made by the
+ * firmware through this module.  SimHost keeps two clocks:
+ *
+ *  wallUs     Real (RTC) time elapsed since the simulation epoch, always advancing
+ *  timer0Us   The time base behind millis()/micros().  Like the real 32U4, it is frozen while
+ *             LowPower.idle() has timer0 switched off, and it runs slow or fast if the CPU clock
+ *             is scaled without rescaling timer0's prescaler to match.
+ *
+ * Every shim that consumes time (delay, analogRead, I2C transfers, EEPROM writes, naps) calls
+ * advance(), which reports the elapsed interval and the board's current draw to an observer
+ * (the solar/battery plant in ComposterSimulator.cpp).
+ */
+
+#ifndef SIMHOST_H_
+#define SIMHOST_H_
+
+#include <stdint.h>
+#include <string>
+
+#define SIM_NUM_PINS 32
+#define SIM_VBUS_PIN 31               //Pseudo input pin:  HIGH while a USB host is plugged in
+
+namespace sim {
+
+  //Board state visible to the plant model
+  struct Board {
+    uint64_t wallUs;                  //Real time since the simulation epoch
+    uint64_t timer0Us;                //millis() time base (frozen while timer0 is off)
+    bool     asleep;                  //CPU is in LowPower.idle()
+    uint8_t  clockShift;              //CPU clock divisor is 1 << clockShift (clock_prescale_set())
+    uint8_t  level[SIM_NUM_PINS];     //Digital output levels written by the firmware
+    uint8_t  duty[SIM_NUM_PINS];      //PWM duty written by analogWrite()
+    uint8_t  input[SIM_NUM_PINS];     //Digital input levels driven by the simulator (buttons)
+    long     eepromWrites;            //EEPROM cells actually rewritten
+    long     naps;                    //Calls to LowPower.idle() with timer0 off
+    long     dozes;                   //Calls to LowPower.idle() that timer0 wakes within a millisecond
+    bool     usbHost;                 //A USB host is plugged in (follows SIM_VBUS_PIN)
+    uint64_t usbAttachUs;             //When the firmware last attached the USB controller
+    std::string serialIn;             //Bytes the host has sent but the firmware hasn't read
+    bool     logSerial;               //Echo the firmware's Serial output to stderr
+  };
+  extern Board board;
+
+  inline unsigned clockDiv() { return 1u << board.clockShift; }
+
+  //Called on every advance() with the interval (seconds) during which the board state was constant
+  typedef void (*Observer)(double dtS);
+  extern Observer observer;
+
+  //Battery terminal voltage (Volts) reported by the plant model to the ADC shim
+  typedef double (*VoltageSource)();
+  extern VoltageSource batteryVolts;
+
+  //Scripted button transitions: pin goes to level at wallUs.  Kept sorted by time.
+  void scheduleInput(uint64_t wallUs, uint8_t pin, uint8_t level);
+  uint64_t nextInputTime();           //wallUs of the next scripted transition (or UINT64_MAX)
+
+  void fault(const char *what);       //The firmware misused the hardware.  Report it and quit.
+  void advance(uint64_t us);          //Consume us microseconds of time in the current board state
+  void compute(uint64_t us);          //Consume us microseconds of 16 MHz CPU work at the current clock
+  void sleepFor(uint64_t us, bool timer0Off);  //Nap until us elapse or a button interrupt fires
+
+  extern double rtcPpm;               //The DS1307's crystal runs fast by this much (ppm)
+  extern double wdtPct;               //The watchdog's oscillator runs fast by this much (percent)
+
+  //Wall-clock calendar helpers (simulation epoch is midnight, January 1 of epochYear)
+  extern int epochYear;
+  long dayNumber(uint64_t wallUs);    //Whole days since the epoch
+  void civilDate(long day, int &year, int &month, int &date, int &weekday);
+  long epochDay(int year, int month, int date);
+
+}
+
+#endif /* SIMHOST_H_ */
@@ -0,0 +1,176 @@
+/**
+ * Arduino.h --- Host-side stand-in for the Arduino core used by the composter simulator
+ *
+ * Only the subset of the Arduino API used by the composter firmware is provided.  All hardware
+ * access is forwarded to the simulated board (SimHost.h).
+ */
+
+#ifndef SIM_ARDUINO_H_
+#define SIM_ARDUINO_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define F_CPU 16000000L
+
+#define HIGH          1
+#define LOW           0
+#define INPUT         0
+#define OUTPUT        1
+#define INPUT_PULLUP  2
+#define CHANGE        1
+#define FALLING       2
+#define RISING        3
+#define DEC          10
+#define HEX          16
+
+//Pro Micro (ATmega32U4) analog pin numbering
+#define A0  18
+#define A1  19
+#define A2  20
+#define A3  21
+
+//Status, timer, ADC, TWI and USB controller registers (avr/io.h, avr/interrupt.h)
+extern volatile uint8_t SREG;
+extern volatile uint8_t TCCR0B;
+extern volatile uint8_t TCCR1B;
+extern volatile uint8_t TIMSK1;
+extern volatile uint8_t TIFR1;
+extern volatile uint8_t TCCR3A;
+extern volatile uint8_t TCCR3B;
+extern volatile uint8_t TIMSK3;
+extern volatile uint8_t TIFR3;
+extern volatile uint16_t OCR3B;
+extern volatile uint8_t TWBR;
+extern volatile uint8_t ADCSRA;
+extern volatile uint8_t USBCON;
+extern volatile uint8_t PLLCSR;
+extern volatile uint8_t UDCON;
+uint8_t sim_usbsta();
+#define USBSTA   sim_usbsta()
+uint8_t sim_tcnt0();
+#define TCNT0    sim_tcnt0()
+struct SimTcnt3 {                     //timer3's 16-bit count.  Only its normal mode is modelled.
+  operator uint16_t() const;
+  SimTcnt3 &operator=(uint16_t count);
+};
+extern SimTcnt3 TCNT3;
+inline void cli() { SREG &= 0x7F; }
+inline void sei() { SREG |= 0x80; }
+#define ISR(vector)  void vector()
+void TIMER1_OVF_vect() __attribute__((weak));   //Called by the simulator as timer1 overflows
+void TIMER3_COMPB_vect() __attribute__((weak)); //...and as timer3 matches OCR3B during a doze
+#define CS00     0
+#define CS01     1
+#define CS02     2
+#define CS10     0
+#define CS11     1
+#define CS12     2
+#define CS30     0
+#define CS31     1
+#define WGM30    0
+#define OCIE3B   2
+#define OCF3B    2
+#define TOIE1    0
+#define TOV1     0
+#define ADEN     7
+#define USBE     7
+#define FRZCLK   5
+#define OTGPADE  4
+#define VBUS     0
+#define PLLE     1
+#define PLOCK    0
+#define DETACH   0
+
+#define digitalPinToInterrupt(p)  (p)
+#define TXLED0
+#define TXLED1
+#define RXLED0
+#define RXLED1
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+int  digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+int  analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int duty);
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration = 0);
+void noTone(uint8_t pin);
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode);
+void detachInterrupt(uint8_t interrupt);
+
+
+//Minimal Arduino String
+class String {
+public:
+  String(const char *s = "") : s(s ? s : "") {}
+  String(const std::string &x) : s(x) {}
+  String(char c) : s(1, c) {}
+  String(unsigned char n, int base = DEC) : s(fmt(n, base)) {}
+  String(int n, int base = DEC) : s(fmt(n, base)) {}
+  String(unsigned int n, int base = DEC) : s(fmt(n, base)) {}
+  String(long n, int base = DEC) : s(fmt(n, base)) {}
+  String(unsigned long n, int base = DEC) : s(fmt(n, base)) {}
+  String(double d, int places = 2);
+  const char *c_str() const { return s.c_str(); }
+  unsigned int length() const { return s.size(); }
+  String &operator+=(const String &x) { s += x.s; return *this; }
+  friend String operator+(const String &a, const String &b) { return String(a.s + b.s); }
+private:
+  static std::string fmt(long n, int base);
+  static std::string fmt(unsigned long n, int base);
+  static std::string fmt(int n, int base) { return fmt((long) n, base); }
+  static std::string fmt(unsigned int n, int base) { return fmt((unsigned long) n, base); }
+  static std::string fmt(unsigned char n, int base) { return fmt((unsigned long) n, base); }
+  std::string s;
+};
+
+
+//USB CDC serial port.  No host is attached unless the simulator says so.
+class SerialShim {
+public:
+  void begin(unsigned long) {}
+  void end() {}
+  void setTimeout(unsigned long) {}
+  void flush() {}
+  operator bool() const;
+  int available();
+  int read();
+  size_t write(uint8_t b);
+  size_t write(const uint8_t *buf, size_t n);
+  size_t print(const String &x);
+  size_t print(const char *x) { return print(String(x)); }
+  size_t print(char x) { return print(String(x)); }
+  size_t print(int x, int base = DEC) { return print(String(x, base)); }
+  size_t print(unsigned int x, int base = DEC) { return print(String(x, base)); }
+  size_t print(long x, int base = DEC) { return print(String(x, base)); }
+  size_t print(unsigned long x, int base = DEC) { return print(String(x, base)); }
+  size_t print(unsigned char x, int base = DEC) { return print(String(x, base)); }
+  size_t print(double x, int places = 2) { return print(String(x, places)); }
+  template <typename T> size_t println(const T &x) { return print(x) + print("\r\n"); }
+  template <typename T> size_t println(const T &x, int f) { return print(x, f) + print("\r\n"); }
+  size_t println() { return print("\r\n"); }
+  long parseInt();
+};
+extern SerialShim Serial;
+#define SerialUSB Serial
+
+//USB device controller
+class USBDeviceShim {
+public:
+  void attach();
+  void detach();
+  bool configured();
+};
+extern USBDeviceShim USBDevice;
+
+#endif /* SIM_ARDUINO_H_ */
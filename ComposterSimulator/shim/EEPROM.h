@@ -0,0 +1,38 @@
+/**
+ * EEPROM.h --- Host-side stand-in for the Arduino EEPROM library
+ *
+ * The 1 KB array starts out zeroed (the schedule disabled).  Writes cost the real part's 3.3 ms
+ * per changed cell, like EEPROM.put()/update() on the 32U4.
+ */
+
+#ifndef SIM_EEPROM_H_
+#define SIM_EEPROM_H_
+
+#include "Arduino.h"
+
+#include <stdint.h>
+#include <string.h>
+
+class EEPROMClass {
+public:
+  uint8_t read(int address) { return mem[address]; }
+  void write(int address, uint8_t value);
+  void update(int address, uint8_t value) { if (mem[address] != value) write(address, value); }
+  uint16_t length() { return sizeof(mem); }
+
+  template <typename T> T &get(int address, T &t) {
+    memcpy(&t, mem + address, sizeof(T));
+    return t;
+  }
+
+  template <typename T> const T &put(int address, const T &t) {
+    const uint8_t *p = (const uint8_t *) &t;
+    for (unsigned i = 0; i < sizeof(T); i++) update(address + i, p[i]);
+    return t;
+  }
+
+  uint8_t mem[1024];
+};
+extern EEPROMClass EEPROM;
+
+#endif /* SIM_EEPROM_H_ */
@@ -0,0 +1,31 @@
+/**
+ * LowPower.h --- Host-side stand-in for the Rocket Scream Low-Power library (ATmega32U4 flavour)
+ */
+
+#ifndef SIM_LOWPOWER_H_
+#define SIM_LOWPOWER_H_
+
+#include "Arduino.h"
+
+enum period_t { SLEEP_15MS, SLEEP_30MS, SLEEP_60MS, SLEEP_120MS, SLEEP_250MS, SLEEP_500MS,
+                SLEEP_1S, SLEEP_2S, SLEEP_4S, SLEEP_8S, SLEEP_FOREVER };
+enum adc_t    { ADC_OFF, ADC_ON };
+enum bod_t    { BOD_OFF, BOD_ON };
+enum timer4_t { TIMER4_OFF, TIMER4_ON };
+enum timer3_t { TIMER3_OFF, TIMER3_ON };
+enum timer1_t { TIMER1_OFF, TIMER1_ON };
+enum timer0_t { TIMER0_OFF, TIMER0_ON };
+enum spi_t    { SPI_OFF, SPI_ON };
+enum usart1_t { USART1_OFF, USART1_ON };
+enum twi_t    { TWI_OFF, TWI_ON };
+enum usb_t    { USB_OFF, USB_ON };
+
+class LowPowerClass {
+public:
+  void idle(period_t period, adc_t adc, timer4_t timer4, timer3_t timer3, timer1_t timer1,
+            timer0_t timer0, spi_t spi, usart1_t usart1, twi_t twi, usb_t usb);
+  void powerDown(period_t period, adc_t adc, bod_t bod);
+};
+extern LowPowerClass LowPower;
+
+#endif /* SIM_LOWPOWER_H_ */
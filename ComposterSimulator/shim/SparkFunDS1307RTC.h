@@ -0,0 +1,40 @@
+/**
+ * SparkFunDS1307RTC.h --- Host-side stand-in for the SparkFun DS1307 RTC library
+ *
+ * The simulated RTC keeps the simulator's wall time plus whatever offset setTime() programmed.
+ * Like the real library, the get*() methods return the fields captured by the last update(),
+ * and each update() costs an I2C transfer.
+ */
+
+#ifndef SIM_SPARKFUNDS1307RTC_H_
+#define SIM_SPARKFUNDS1307RTC_H_
+
+#include "Arduino.h"
+
+#include <stdint.h>
+
+enum sqw_rate { SQW_SQUARE_1, SQW_SQUARE_4K, SQW_SQUARE_8K, SQW_SQUARE_32K, SQW_LOW, SQW_HIGH };
+
+class DS1307 {
+public:
+  void begin();
+  void writeSQW(sqw_rate) {}
+  void set24Hour(bool) {}
+  bool update();
+  bool setTime(uint8_t sec, uint8_t min, uint8_t hour, uint8_t day, uint8_t date, uint8_t month, uint8_t year);
+  bool autoTime() { return true; }
+  uint8_t getSecond() { return second; }
+  uint8_t getMinute() { return minute; }
+  uint8_t getHour() { return hour; }
+  uint8_t getDay() { return day; }
+  uint8_t getDate() { return date; }
+  uint8_t getMonth() { return month; }
+  uint8_t getYear() { return year; }
+
+  long long offsetS;              //Programmed time minus simulator wall time (seconds)
+private:
+  uint8_t second, minute, hour, day, date, month, year;
+};
+extern DS1307 rtc;
+
+#endif /* SIM_SPARKFUNDS1307RTC_H_ */
@@ -0,0 +1,16 @@
+/**
+ * Wire.h --- Host-side stand-in for the Arduino I2C library (the RTC shim does the real work)
+ */
+
+#ifndef SIM_WIRE_H_
+#define SIM_WIRE_H_
+
+#include "Arduino.h"
+
+class TwoWire {
+public:
+  void begin() {}
+};
+extern TwoWire Wire;
+
+#endif /* SIM_WIRE_H_ */
@@ -0,0 +1,54 @@
+/**
+ * avr/power.h --- Host-side stand-in for avr-libc's power reduction macros (ATmega32U4)
+ *
+ * The macros set and clear bits in simulated power reduction registers so the simulator can see
+ * which peripherals the firmware leaves powered.  clock_prescale_set() scales the simulated CPU clock.
+ */
+
+#ifndef SIM_AVR_POWER_H_
+#define SIM_AVR_POWER_H_
+
+#include <stdint.h>
+
+extern volatile uint8_t PRR0;
+extern volatile uint8_t PRR1;
+
+#define PRADC     0
+#define PRUSART0  1
+#define PRSPI     2
+#define PRTIM1    3
+#define PRTIM0    5
+#define PRTWI     7
+#define PRUSART1  0
+#define PRTIM3    3
+#define PRTIM4    4
+#define PRUSB     7
+
+typedef enum {
+  clock_div_1 = 0, clock_div_2, clock_div_4, clock_div_8, clock_div_16,
+  clock_div_32, clock_div_64, clock_div_128, clock_div_256
+} clock_div_t;
+
+void clock_prescale_set(clock_div_t div);
+clock_div_t clock_prescale_get();
+
+#define power_adc_enable()      (PRR0 &= (uint8_t) ~(1 << PRADC))
+#define power_adc_disable()     (PRR0 |= (uint8_t) (1 << PRADC))
+#define power_spi_enable()      (PRR0 &= (uint8_t) ~(1 << PRSPI))
+#define power_spi_disable()     (PRR0 |= (uint8_t) (1 << PRSPI))
+#define power_timer0_enable()   (PRR0 &= (uint8_t) ~(1 << PRTIM0))
+#define power_timer0_disable()  (PRR0 |= (uint8_t) (1 << PRTIM0))
+#define power_timer1_enable()   (PRR0 &= (uint8_t) ~(1 << PRTIM1))
+#define power_timer1_disable()  (PRR0 |= (uint8_t) (1 << PRTIM1))
+#define power_twi_enable()      (PRR0 &= (uint8_t) ~(1 << PRTWI))
+#define power_twi_disable()     (PRR0 |= (uint8_t) (1 << PRTWI))
+#define power_usart1_enable()   (PRR1 &= (uint8_t) ~(1 << PRUSART1))
+#define power_usart1_disable()  (PRR1 |= (uint8_t) (1 << PRUSART1))
+#define power_timer3_enable()   (PRR1 &= (uint8_t) ~(1 << PRTIM3))
+#define power_timer3_disable()  (PRR1 |= (uint8_t) (1 << PRTIM3))
+#define power_timer4_enable()   (PRR1 &= (uint8_t) ~(1 << PRTIM4))
+#define power_timer4_disable()  (PRR1 |= (uint8_t) (1 << PRTIM4))
+#define power_usb_enable()      (PRR1 &= (uint8_t) ~(1 << PRUSB))
+#define power_usb_disable()     (PRR1 |= (uint8_t) (1 << PRUSB))
+
+#endif /* SIM_AVR_POWER_H_ */
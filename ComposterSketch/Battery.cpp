@@ -10,9 +10,12 @@
  * 
  * Note:  This implementation assumes that the battery is charged by a small solar panel.
  * If the solar panel manages to over-charge the battery, the associated firmware will
- * avoid sleeping the processor and will extend the duration of the scheduled autorun to
- * drain the charge.  When the battery is considered discharged, the associated firmware
- * will avoid running the motor to preserve what remains.
+ * turn the drum for extra pulses to put the surplus to work (see Schedule.cpp).  The
+ * battery is overcharged from the first sample above VMAX until one falls below VHIGHOFF,
+ * so that the surplus pulses don't start and stop with every passing cloud.  A pulse's own
+ * load sags the voltage, so samples taken while the motor runs are held out.  When the
+ * battery is considered discharged, the associated firmware will avoid running the motor
+ * to preserve what remains.
  * 
  * Note:  All the methods are implemented as statics because we assume the Composter has a
  * single battery (no need for Battery objects).
@@ -25,13 +28,13 @@
  #include <Arduino.h>
  #include "Composter.h"
  #include "PDebug.h"
- #include "PinAssignments.h"
+ #include "pinAssignments.h"
+ #include "PPower.h"
  #include "Battery.h" 
 
-
- //Define the min..max battery voltage range
- #define VMIN 110                   //11.0 Volts:  The battery is discharged.
- #define VMAX 140                   //14.0 Volts:  The battery is fully charged
+ int Battery::sampled = 0;
+ bool Battery::high = false;
+ bool Battery::held = false;
 
 
  /**
@@ -39,24 +42,53 @@
   */
   int Battery::getVoltage() {
 
+    PPower::acquire(PWRADC);                    //Power-up the ADC just long enough for one conversion
     int vx10 = analogRead(pinBattery) / 2;      //Scaled such that 100 == 10.0 Volts
+    PPower::release(PWRADC);
     //DPRINT(String("getVoltage=")+String(vx10));
     return vx10;    
   }
 
 
   /**
-   * isLow --- Determines if the battery voltage is excessively low
+   * update --- Samples the battery voltage.  The sketch's scheduler calls this once a second and after each nap.
+   */
+   void Battery::update() {
+    sampled = getVoltage();
+    if (held) return;
+    if (sampled > VMAX) high = true;
+    else if (sampled < VHIGHOFF) high = false;
+   }
+
+
+  /**
+   * hold --- Holds isHigh() as it is while the motor's load drags the voltage down
+   */
+   void Battery::hold(bool h) {
+    held = h;
+   }
+
+
+  /**
+   * getSampled --- Returns the battery voltage (scaled like getVoltage()) when last sampled
+   */
+   int Battery::getSampled() {
+    return sampled;
+   }
+
+
+  /**
+   * isLow --- Determines if the battery voltage was excessively low when last sampled
    */
    bool Battery::isLow() {
-    return getVoltage()<VMIN;
+    return sampled<VMIN;
    }
 
 
    /**
-    * isHigh --- Determines if the battery voltage is excessively high
+    * isHigh --- Determines if the battery is overcharged:  true from a sample above VMAX until one below VHIGHOFF
     */
     bool Battery::isHigh() {
-      return getVoltage()>VMAX;
+      return high;
     }
 
@@ -3,15 +3,30 @@
  * 
  */
 
+#ifndef BATTERY_H_
+#define BATTERY_H_
+
+//Define the min..max battery voltage range (scaled so that 100 represents 10.0 Volts)
+#define VMIN 110                   //11.0 Volts:  The battery is discharged.
+#define VMAX 140                   //14.0 Volts:  The battery is fully charged.  Above this, it is overcharged...
+#define VHIGHOFF 135               //13.5 Volts:  ...until it falls below this
+
 class Battery {
 
 public:
-  static bool isLow();          //Is the battery voltage excessively low?
-  static bool isHigh();         //Is the battery voltage excessively high?
-  static int getVoltage();      //Read the battery voltage
+  static void update();         //Sample the battery voltage for isLow() and isHigh()
+  static bool isLow();          //Was the battery voltage excessively low when last sampled?
+  static bool isHigh();         //Is the battery overcharged (with hysteresis)?
+  static void hold(bool);       //Hold isHigh() as it is while the motor drags the voltage down
+  static int getVoltage();      //Read the battery voltage now
+  static int getSampled();      //Battery voltage at the last update()
  
 private:
+  static int sampled;           //Voltage at the last update()
+  static bool high;             //Overcharged
+  static bool held;             //isHigh() is held
 
  
 };
 
+#endif /* BATTERY_H_ */
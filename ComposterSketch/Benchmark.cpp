@@ -0,0 +1,255 @@
+/******************************************************************************************************************
+ * Benchmark.cpp --- On-target measurements of what the composter's firmware costs on its real board
+ *
+ * The quick operations are timed with micros(), which counts in 4 uS steps, so each is repeated BENCHREPS times
+ * and the time of an empty loop is taken off.  Cycles are counted at the clock the CPU runs at during the
+ * measurement.  That is 16 MHz throughout, since a USB host is connected (see PClock.cpp).
+ *
+ * Anything that can't be repeated is timed in CPU cycles by timer3, run as a stopwatch at prescale /1.  (Timer1
+ * carries the motor's PWM and ramp interrupt.)  Timer3 is free except while SoundMaker plays a tone, and the
+ * stopwatch puts its configuration back afterward so that tone() finds it as it left it.  The 16-bit count wraps
+ * every 4 mS at 16 MHz, so micros() supplies the whole wraps.
+ *
+ * The wake from a doze is timed from a timer3 compare match BENCHLEADCYCLES ahead, which ends the doze just as
+ * timer0's overflow does in loop().  It counts the cycles from the match to the instruction after LowPower.idle(),
+ * an empty interrupt handler included.  Dozes that USB or timer0 end first are not counted, and the least of
+ * BENCHWAKES is reported.
+ *
+ * Each pass through loop() is timed by the stopwatch as well.  A pass that plays a tone takes timer3 away from it,
+ * but lasts long enough for micros() to time it well.
+ *
+ * The relay settle is timed through the controller's MOTORAWAKENING state, from wake() to MOTORSTOPPED, polled
+ * every BENCHPOLLUS.  wake() returns the controller to standby without starting the motor, and counts nothing in
+ * Stats or StandbyPolicy.
+ *
+ ******************************************************************************************************************/
+
+#include <EEPROM.h>
+#include <SparkFunDS1307RTC.h>
+
+#include "Arduino.h"
+#include "Composter.h"
+#include "PDebug.h"
+#include "LowPower.h"
+#include "PButton.h"
+#include "PClock.h"
+#include "PPower.h"
+#include "MotorController.h"
+#include "pinAssignments.h"
+#include "Benchmark.h"
+
+#define BENCHREPS     100                 //Repetitions of each quick operation
+#define BENCHWAKES    64                  //Dozes timed...
+#define BENCHTRIES    1024                //...out of at most this many
+#define BENCHLEADCYCLES 256               //Each doze is ended by timer3 after this many cycles
+#define BENCHPOLLUS   50                  //Polling interval while the relay settles (uS)
+#define WATCHCS       (1 << CS30)         //The stopwatch's clock select:  timer3 at prescale /1
+
+bool Benchmark::on = false;
+unsigned long Benchmark::watchUs;
+byte Benchmark::watchA;
+byte Benchmark::watchB;
+bool Benchmark::watching = false;
+unsigned long Benchmark::passCycles[BENCHSTATES];
+unsigned long Benchmark::passes[BENCHSTATES];
+unsigned long Benchmark::passMax[BENCHSTATES];
+static volatile bool matched;             //Timer3's compare match has ended the doze
+
+
+//Timer3's compare match B ends a doze being timed
+ISR(TIMER3_COMPB_vect) {
+  matched = true;
+}
+
+
+/**
+ * Are both buttons held down through BENCHHOLDMS?  Returns at once unless both are down as we boot.
+ * pinA, pinB - the buttons' pins
+ */
+bool Benchmark::isRequested(byte pinA, byte pinB) {
+  unsigned long t0 = millis();
+  while (digitalRead(pinA) == PRESSED && digitalRead(pinB) == PRESSED) {
+    if (millis() - t0 >= BENCHHOLDMS) return true;
+    delay(10);
+  }
+  return false;
+}
+
+
+/**
+ * Time the fixed suite and LOG the report
+ * motor - the drum's motor controller, which should be in standby
+ */
+void Benchmark::run(MotorController &motor) {
+  volatile long sink;                     //Keeps the compiler from optimizing the work away
+  unsigned long t0;
+  on = true;
+  LOG(String("Benchmark at ")+String(PClock::isFast() ? 16 : 2)+" MHz");
+
+  //An empty loop, whose time is taken off the quick operations
+  t0 = micros();
+  for (unsigned int i = 0; i < BENCHREPS; i++) sink = i;
+  unsigned long empty = micros() - t0;
+
+  //digitalWrite(), flickering the Scheduled LED
+  t0 = micros();
+  for (unsigned int i = 0; i < BENCHREPS; i++) digitalWrite(pinSkedLED, i & 1);
+  report("digitalWrite", cycles(micros() - t0 - empty), BENCHREPS);
+  digitalWrite(pinSkedLED, LOW);          //The LED task will put it right
+
+  //EEPROM.get() of a long
+  t0 = micros();
+  for (unsigned int i = 0; i < BENCHREPS; i++) {
+    long value;
+    EEPROM.get(EESKEDSTART, value);
+    sink = value;
+  }
+  report("EEPROM.get", cycles(micros() - t0 - empty), BENCHREPS);
+
+  //analogRead() of the battery, as Battery does it
+  PPower::acquire(PWRADC);
+  t0 = micros();
+  for (unsigned int i = 0; i < BENCHREPS; i++) sink = analogRead(pinBattery);
+  report("analogRead", cycles(micros() - t0 - empty), BENCHREPS);
+  PPower::release(PWRADC);
+
+  //rtc.update(), an I2C transfer, as Schedule does it
+  PPower::acquire(PWRTWI);
+  t0 = micros();
+  for (unsigned int i = 0; i < BENCHREPS; i++) rtc.update();
+  report("rtc.update", cycles(micros() - t0 - empty), BENCHREPS);
+  PPower::release(PWRTWI);
+
+  (void) sink;
+
+  //The relay settle, through the controller's MOTORAWAKENING state
+  t0 = micros();
+  if (motor.wake()) {
+    while (motor.getState() == MOTORAWAKENING) {
+      delayMicroseconds(BENCHPOLLUS);
+      motor.update();
+    }
+    report("relay settle", cycles(micros() - t0), 1);
+  } else {
+    LOG("bench relay settle:  controller not in standby");
+  }
+
+  //Wake from a doze, as PSleep::doze() dozes
+  if (!startWatch()) {
+    LOG("bench idle wake:  timer3 is busy");
+    return;
+  }
+  uint16_t fastest = 0xFFFF;
+  unsigned int wakes = 0;
+  for (unsigned int i = 0; i < BENCHTRIES && wakes < BENCHWAKES; i++) {
+    matched = false;
+    OCR3B = TCNT3 + BENCHLEADCYCLES;
+    TIFR3 = (1 << OCF3B);                 //Clear any earlier match
+    TIMSK3 |= (1 << OCIE3B);
+    LowPower.idle(SLEEP_FOREVER, ADC_ON, TIMER4_ON, TIMER3_ON, TIMER1_ON, TIMER0_ON,
+                  SPI_ON, USART1_ON, TWI_ON, USB_ON);
+    uint16_t late = TCNT3 - OCR3B;
+    TIMSK3 &= ~(1 << OCIE3B);
+    if (!matched) continue;               //Something else ended the doze first
+    wakes++;
+    if (late < fastest) fastest = late;
+  }
+  stopWatch();
+  if (wakes > 0) report("idle wake", fastest, 1);
+  else LOG("bench idle wake:  every doze was ended early");
+}
+
+
+//Has run() been invoked?
+bool Benchmark::isOn() {
+  return on;
+}
+
+
+/**
+ * Start timing a pass through loop()
+ */
+void Benchmark::startPass() {
+  watching = startWatch();
+  if (!watching) watchUs = micros();
+}
+
+
+/**
+ * Finish timing a pass through loop().  Totals stop short of overflowing, which takes over an hour of passes.
+ * state - the comState the pass ran in
+ */
+void Benchmark::pass(byte state) {
+  unsigned long c;
+  if (watching) {
+    c = readWatch();
+    stopWatch();
+  } else {
+    c = cycles(micros() - watchUs);
+  }
+  if (state >= BENCHSTATES) return;
+  if (passCycles[state] + c < passCycles[state]) return;
+  passCycles[state] += c;
+  passes[state]++;
+  if (c > passMax[state]) passMax[state] = c;
+}
+
+
+/**
+ * Report the loop passes timed in each state
+ * names - the states' names
+ * n - number of states
+ */
+void Benchmark::printPasses(const char * const *names, byte n) {
+  for (byte s = 0; s < n && s < BENCHSTATES; s++) {
+    if (passes[s] == 0) continue;
+    LOG(String("bench pass ")+names[s]+":  "+String(passes[s])+" passes, mean "+String(passCycles[s] / passes[s])+
+        " cycles, max "+String(passMax[s])+" cycles");
+  }
+}
+
+
+//Private method to count the CPU cycles in so many uS at the current clock
+unsigned long Benchmark::cycles(unsigned long us) {
+  return us * (PClock::isFast() ? 16 : 2);
+}
+
+
+//Private method to LOG a measurement of n operations taking c cycles in all
+void Benchmark::report(const char *what, unsigned long c, unsigned int n) {
+  LOG(String("bench ")+what+":  "+String(c / (double) n / (PClock::isFast() ? 16 : 2), 2)+" uS, "+
+      String(c / n)+" cycles");
+}
+
+
+//Private method to start timer3 counting CPU cycles from zero.  Returns false if tone() is using it.
+bool Benchmark::startWatch() {
+  if (PPower::isPowered(PWRTIMER3)) return false;
+  PPower::acquire(PWRTIMER3);
+  watchA = TCCR3A;
+  watchB = TCCR3B;
+  TCCR3A = 0;                             //Normal mode...
+  TCCR3B = WATCHCS;                       //...counting every CPU cycle
+  TCNT3 = 0;
+  watchUs = micros();
+  return true;
+}
+
+
+//Private method to read the cycles counted since startWatch().  Falls back on micros() if tone() took timer3.
+unsigned long Benchmark::readWatch() {
+  uint16_t ticks = TCNT3;
+  unsigned long c = cycles(micros() - watchUs);
+  if (TCCR3B != WATCHCS) return c;
+  return ticks + ((c - ticks + 0x8000UL) & ~0xFFFFUL);  //micros() is good to far better than half a wrap
+}
+
+
+//Private method to give timer3 back, as tone() left it unless tone() has since reconfigured it
+void Benchmark::stopWatch() {
+  if (TCCR3B == WATCHCS) {
+    TCCR3A = watchA;
+    TCCR3B = watchB;
+  }
+  PPower::release(PWRTIMER3);
+}
@@ -0,0 +1,45 @@
+/**
+ * Benchmark.h --- On-target measurements of what the composter's firmware costs on its real board
+ *
+ * Holding B1 and B2 together for BENCHHOLDMS while the composter boots enters benchmark mode.  Once a USB host has
+ * connected, run() times a fixed suite of operations (an RTC read, an ADC conversion, an EEPROM read, a digital
+ * write, the relay settle and the wake from a doze) and LOGs a report.  The composter then carries on as usual, except that each
+ * pass through loop() is timed by the state it ran in.  Those figures are printed each time B1 and B2 are pressed
+ * together.  Comparing reports compares firmware builds and board revisions.
+ */
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include "Arduino.h"
+#include "MotorController.h"
+
+#define BENCHHOLDMS   3000L               //Hold B1 and B2 this long at boot to benchmark
+#define BENCHUSBMS    30000L              //Wait this long for a USB host to report to
+#define BENCHSTATES   12                  //Loop states that can be timed
+
+class Benchmark {
+public:
+  static bool isRequested(byte, byte);    //Are both buttons held down through BENCHHOLDMS?
+  static void run(MotorController &);     //Time the fixed suite and report it
+  static bool isOn();                     //Has run() been invoked?
+  static void startPass();                //Start timing a pass through loop()...
+  static void pass(byte);                 //...and finish, recording it against a state
+  static void printPasses(const char * const *, byte);  //Report the loop passes by state
+
+private:
+  static unsigned long cycles(unsigned long);  //CPU cycles in so many uS at the current clock
+  static void report(const char *, unsigned long, unsigned int);  //LOG a measurement (cycles, count)
+  static bool startWatch();               //Start timer3 counting CPU cycles, if it's free
+  static unsigned long readWatch();       //Cycles since startWatch()
+  static void stopWatch();                //Give timer3 back
+  static bool on;
+  static unsigned long watchUs;           //micros() when the stopwatch started
+  static byte watchA, watchB;             //Timer3's TCCR3A and TCCR3B before the stopwatch took it
+  static bool watching;                   //The stopwatch is timing this pass
+  static unsigned long passCycles[BENCHSTATES];  //Total cycles spent in passes in each state
+  static unsigned long passes[BENCHSTATES];      //Number of passes in each state
+  static unsigned long passMax[BENCHSTATES];     //Cycles in the longest pass in each state
+};
+
+#endif /* BENCHMARK_H_ */
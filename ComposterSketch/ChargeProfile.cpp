@@ -0,0 +1,91 @@
+/******************************************************************************************************************
+ * ChargeProfile.cpp --- Hourly profile of the battery voltage
+ *
+ * When the hour changes, the mean of the samples taken during the hour just ended is blended into its level with
+ * a weight of 1/4, so a level follows the seasons and the weather over about four days.  A new level (or one found
+ * erased in EEPROM) simply takes the first mean.  Levels are written back as they change, which is one write of a
+ * couple of cells per hour and so once a day for any one cell.
+ *
+ * Note:  The samples are nearly all taken at rest, between naps.  An autorun adds only a sample or two under load
+ * to its hour, so it hardly drags down the level of the hour it runs in.
+ *
+ ******************************************************************************************************************/
+
+#include <EEPROM.h>
+
+#include "Arduino.h"
+#include "Composter.h"
+#include "PDebug.h"
+#include "ChargeProfile.h"
+
+#define PROFILESCALE    16                //Fixed-point scale of a level
+#define PROFILEBLEND    2                 //A new mean is blended in with weight 1/(2^PROFILEBLEND)
+#define PROFILEMAX      (255*PROFILESCALE)  //Higher levels are erased EEPROM
+#define PROFILEMARGIN   (1*PROFILESCALE)    //A peak must rise 0.1V above the lowest level around it
+
+
+/**
+ * Constructor.  Nothing is learned until load().
+ */
+ChargeProfile::ChargeProfile() {
+  for (byte h = 0; h < PROFILEHOURS; h++) level[h] = 0;
+  hour = NOPEAK;
+  sum = 0;
+  n = 0;
+}
+
+
+/**
+ * Restore the learned levels from EEPROM
+ */
+void ChargeProfile::load() {
+  for (byte h = 0; h < PROFILEHOURS; h++) {
+    EEPROM.get(EEPROFILE + h * sizeof(level[0]), level[h]);
+    if (level[h] > PROFILEMAX) level[h] = 0;        //Never written
+  }
+}
+
+
+/**
+ * Record a battery voltage sample
+ * h - hour of the day (0..23) when it was read
+ * vx10 - battery voltage scaled so that 100 represents 10.0 Volts (0 if not yet read)
+ */
+void ChargeProfile::sample(byte h, int vx10) {
+  if (vx10 <= 0) return;
+
+  //A new hour:  fold the last hour's mean into its level
+  if (h != hour) {
+    if (n > 0 && hour < PROFILEHOURS) {
+      unsigned int mean = sum * PROFILESCALE / n;
+      if (level[hour] == 0) level[hour] = mean;
+      else level[hour] += ((int) mean - (int) level[hour]) >> PROFILEBLEND;
+      EEPROM.put(EEPROFILE + hour * sizeof(level[0]), level[hour]);
+      DPRINT(String("profile hour ")+String(hour)+String(" level ")+String(level[hour]));
+    }
+    hour = h;
+    sum = 0;
+    n = 0;
+  }
+  sum += vx10;
+  n++;
+}
+
+
+/**
+ * Find the hour at which the battery is usually fullest
+ * first..last - hours of the day to consider (first <= last)
+ * Returns the earliest of the learned hours with the highest level, or NOPEAK if the learned levels are too flat
+ * to have a peak (as in winter, when the panel barely keeps up with the standby load) or none have been learned
+ */
+byte ChargeProfile::peakHour(byte first, byte last) {
+  byte peak = NOPEAK;
+  unsigned int lowest = PROFILEMAX;
+  for (byte h = first; h <= last && h < PROFILEHOURS; h++) {
+    if (level[h] == 0) continue;
+    if (peak == NOPEAK || level[h] > level[peak]) peak = h;
+    if (level[h] < lowest) lowest = level[h];
+  }
+  if (peak != NOPEAK && level[peak] - lowest < PROFILEMARGIN) return NOPEAK;
+  return peak;
+}
@@ -0,0 +1,32 @@
+/**
+ * ChargeProfile.h --- Learns the battery's daily voltage curve so the autorun can follow the sun
+ *
+ * The schedule feeds in the battery voltage each time it reads the clock.  The samples taken during each hour of
+ * the day are averaged, and each hour's average is blended into a per-hour level that follows the seasons over a
+ * few days.  The levels are kept in EEPROM so a brownout doesn't forget them.  peakHour() finds the hour at which
+ * the battery is usually fullest, which is when an autorun costs the least depth of discharge (see Schedule.cpp).
+ */
+
+#ifndef CHARGEPROFILE_H_
+#define CHARGEPROFILE_H_
+
+#include "Arduino.h"
+
+#define PROFILEHOURS  24
+#define NOPEAK        255                 //peakHour() found no learned hour
+
+class ChargeProfile {
+public:
+  ChargeProfile();
+  void load();                            //Restore the learned levels from EEPROM
+  void sample(byte, int);                 //Record a battery voltage (x10) read during an hour of the day
+  byte peakHour(byte, byte);              //Learned hour in first..last with the highest level, or NOPEAK
+
+private:
+  unsigned int level[PROFILEHOURS];       //Learned voltage x10 in each hour, scaled by 16 (0 if not yet learned)
+  byte hour;                              //Hour being sampled
+  long sum;                               //Sum of its samples
+  unsigned int n;                         //Number of samples
+};
+
+#endif /* CHARGEPROFILE_H_ */
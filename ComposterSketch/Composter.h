@@ -5,27 +5,135 @@
 //Debug configuration
  #define  DEBUG  0
 
- //Wait for USB Serial port when debugging
+ //Wait for USB Serial port when debugging (in production this would cost seconds awake per nap)
+#if DEBUG==1
  #define  DWAITUSB(n)    {for(int i=1;i<=n&&(!SerialUSB);i++) delay(1000);}
+#else
+ #define  DWAITUSB(n)
+#endif
  
+//Binary telemetry to a USB host (see PTelemetry.h).  Opt in by setting TELEMETRY to 1 (or -DTELEMETRY=1).
+//The host decoder discards the LOG/DPRINT text sharing the port, so leave DEBUG off while using it.
+#ifndef TELEMETRY
+#define TELEMETRY 0
+#endif
+#ifndef TELEMS
+#define TELEMS 100L             //Telemetry frame period
+#endif
  
 //How many ms to wait before deciding the B3 button has been held
 #define BHMS 500
 
-//Programmed timer durations (with special cases for debugging)
+//Programmed timer durations (with special cases for debugging).  Each may be overridden at compile
+//time (e.g. -DARMS=90000L) so the host-side simulator can evaluate alternative control policies.
 #if DEBUG==1
+#ifndef ARMS
 #define ARMS 5000L              //Autorun duration.  In debug mode, autorun duration 5 seconds
-#define MCMS 5000L              //Power-off the motor controller after 5 seconds of inactivity
+#endif
+#ifndef MCMS
+#define MCMS 5000L              //Initial hold of the motor controller's power after the motor stops (see StandbyPolicy.h)
+#endif
+#ifndef IAMS
 #define IAMS 20000L             //Inactive interval. In debug mode, place processor to sleep after 20 seconds of inactivity
+#endif
 #else
+#ifndef ARMS
 #define ARMS 60000L             //Autorun duration.  In production mode, autorun for 60 seconds
-#define MCMS 5000L              //Power-off the motor controller after 5 seconds of inactivity
+#endif
+#ifndef MCMS
+#define MCMS 5000L              //Initial hold of the motor controller's power after the motor stops (see StandbyPolicy.h)
+#endif
+#ifndef IAMS
 #define IAMS 30000L             //Inactive interval. In production mode, place processor to sleep after 30 seconds of inactivity
 #endif
+#endif
+
+//Timekeeping.  Schedule reads the RTC every CLOCKREADS seconds.  In between, it counts the time awake with millis()
+//and each nap as NAPMS (the watchdog's SLEEP_8S in PSleep.cpp), since millis() stands still while napping.  A nap
+//that a button cut short could have lasted anywhere up to NAPMS, so it counts as BUTTONNAPMS.  Stats does the same.
+#ifndef CLOCKREADS
+#define CLOCKREADS 3600L
+#endif
+#define NAPMS 8000L
+#define BUTTONNAPMS (NAPMS / 2)
+
+//Pulsed autorun.  The autorun turns the drum in AUTOPULSES pulses of ARMS/AUTOPULSES each, alternately CCW and CW,
+//resting PULSERESTMS between them so the battery can recover from the motor's sag.  AUTOPULSES 1 is one continuous
+//CCW run.  Every pulse costs the drive train an accel/decel cycle, so pulses are few and kept well apart.
+#ifndef AUTOPULSES
+#define AUTOPULSES 4
+#endif
+#ifndef PULSERESTMS
+#define PULSERESTMS 10000L
+#endif
+#if AUTOPULSES < 1 || AUTOPULSES > 6
+#error "AUTOPULSES must be 1..6"
+#endif
+#if PULSERESTMS < 5000L
+#error "PULSERESTMS must be at least 5000L to spare the drive train"
+#endif
+
+//Adaptive standby of the motor controller (see StandbyPolicy.h).  A relay cycle is costed as MCCYCLEMS of holding
+//the controller powered.  Holding draws MCHOLDMA.  A cycle draws MCINRUSHUC into the controller's input capacitors as
+//the relay closes, and MCWAKEUC keeping the board awake through the TIMER1_MS wake, which alone would break even with
+//about 135 mS of holding.  These are estimates (MCHOLDMA matches the simulator's I_RELAY + I_MC_STANDBY); calibrate
+//them against the real unit.  A cycle also switches that inrush through the relay's contacts, wearing them faster
+//than their mechanical rating, and clicks and delays the drum on every jog press.  That is weighed as MCWEARMS of
+//holding (about 0.13 mAh), so holds through the few-second pauses of jogging win, while the PULSERESTMS rests of an
+//autorun are still cheaper to cycle through.
+//With no history the hold is MCMS.  Holds never exceed MCMSMAX, which must stay below IAMS so that a gap spanning a
+//nap is seen as longer than any hold.  Runs up to MCJOGMS long are jogging and learn their hold apart from longer runs.
+#ifndef MCHOLDMA
+#define MCHOLDMA 95L            //Relay coil (75 mA) and RB-Cyt-133 logic (20 mA)
+#endif
+#ifndef MCINRUSHUC
+#define MCINRUSHUC 12600L       //About 1000 uF charged to 12.6 V (uC)
+#endif
+#ifndef MCWAKEUC
+#define MCWAKEUC 150L           //Board awake at 2 MHz (15 mA) for 10 mS (uC)
+#endif
+#ifndef MCWEARMS
+#define MCWEARMS 5000L
+#endif
+#ifndef MCCYCLEMS
+#define MCCYCLEMS ((MCINRUSHUC + MCWAKEUC) / MCHOLDMA + MCWEARMS)   //uC / mA == mS.  5134 mS as set.
+#endif
+#ifndef MCMSMAX
+#define MCMSMAX 15000L
+#endif
+#ifndef MCJOGMS
+#define MCJOGMS 15000L
+#endif
+#if MCMSMAX >= IAMS
+#error "MCMSMAX must stay below IAMS"
+#endif
+
+//Solar-aware autorun.  With SOLARAUTORUN 1 the daily autorun moves from the time B3 was tapped to just after the
+//hour at which the battery is usually fullest, but never more than SOLARSLEWH hours either way (see Schedule.cpp).
+#ifndef SOLARAUTORUN
+#define SOLARAUTORUN 1
+#endif
+#ifndef SOLARSLEWH
+#define SOLARSLEWH 4
+#endif
+
+//Managed overcharge.  While the battery is overcharged (see Battery.h), the composter naps as usual and spends the
+//panel's surplus on extra pulses of ARMS/AUTOPULSES, OCGAPS seconds apart, up to OCDAYMS of extra motor time a day.
+#ifndef OCGAPS
+#define OCGAPS 3600L
+#endif
+#ifndef OCDAYMS
+#define OCDAYMS 120000L
+#endif
 
 //EEPROM address assignments
 #define EESKEDSTART 0          //Locations 0..3 reserved for Scheduler's long startTime
-#define EESKEDEN 4             //Location 4 reserved for Scheduler's bool enabled
+#define EESKEDEN (EESKEDSTART+sizeof(long))  //Location 4 reserved for Scheduler's bool enabled (sized for the host simulator too)
+#define EEPROFILE (EESKEDEN+sizeof(bool))    //Locations 5..52 reserved for ChargeProfile's hourly levels
+#define EESTATS (EEPROFILE+24*sizeof(unsigned int))  //Locations 53..185 reserved for Stats
+#define EERTCSYNC 1008         //Locations 1008..1011 reserved for the RTC's last sync (seconds since 2000, 0 if none)
+#define EERTCPPM  1016         //Locations 1016..1019 reserved for the RTC's measured drift (ppm, + when fast)
+                               //The RTC calibration is also written by SetComposterTime, which can't include this file
 
 
 //Define the frequencies of some audio notes
@@ -7,20 +7,27 @@
  *  Button1 press:    Rotate drum clockwise (CW) until released
  *  Button2 press:    Rotate drum counterclockwise (CCW) until released
  *  Button3 press:    Program drum to autorun periodically starting 24 hours from now
+ *  Autorun:          AUTOPULSES pulses alternating CCW and CW with rests between them (see Composter.h)
  *  Button3 hold:     Cancel drum scheduler's autorun program
  *  Speaker:          Audible feedback (clicks and beeps) to control panel user
  *  
  * Other Functionality
  *  Sleep:            Microprocessor naps after period of inactivity
  *  Awaken:           Microprocessor awakens after sleeping
- *  Battery:          Sleeps and ignores autorun schedule if discharged, sucks power if overcharged
+ *  Battery:          Sleeps and ignores autorun schedule if discharged, spends the surplus on extra pulses if overcharged
+ *  Solar autorun:    Moves the daily autorun to just after the battery's usual daily peak (see Schedule.cpp)
+ *  Statistics:       Kept in EEPROM and printed to a USB host on connection or B1+B2 (see Stats.h)
+ *  Benchmark:        Hold B1+B2 while booting to time the board's operations and each loop() pass (see Benchmark.h)
  *  
  * Resource Usage:
  *  arduino pins      Defined in pinAssignments.h
- *  timer0            millis and delay
+ *  timer0            millis and delay; its overflow wakes loop() from a doze between scheduled tasks
  *  timer1            PWM controlling motor speed on pin 9
+ *  timer3            tone() for the speaker
  *  WDT               Watchdog timer awakens processor from nap with an interrupt after 8 seconds of idleness
  *  RTC               On the I2C bus
+ *  Peripherals       Powered only while a subsystem holds them (see PPower.cpp)
+ *  CPU clock         2 MHz unless a subsystem holds 16 MHz; timers, ADC and TWI are rescaled (see PClock.cpp)
  *  
  *  References
  *  Sketch for C/C++  https://github.com/arduino/Arduino/wiki/Build-Process 
@@ -47,6 +54,13 @@
 #include "Battery.h"
 #include "LED.h"
 #include "SoundMaker.h"
+#include "PPower.h"
+#include "PUsb.h"
+#include "PClock.h"
+#include "PTelemetry.h"
+#include "PScheduler.h"
+#include "Stats.h"
+#include "Benchmark.h"
 #include <SparkFunDS1307RTC.h>
 
 //Define the composter states
@@ -58,8 +72,10 @@ enum comState {
   B3W,             //Button 3 wait
   B3R,             //Button 3 released
   ARN,             //Autorunning the drum
-  NAP              //Processor is napping to save power
+  NAP,             //Processor is napping to save power
+  ARP              //Autorun pausing between pulses
 };
+static const char * const stateNames[] = {"IDL", "RCW", "RCC", "DCL", "B3W", "B3R", "ARN", "NAP", "ARP"};
 
 //Define objects referenced by composter controller
 static Schedule sked = Schedule();               //Autorun scheduler
@@ -68,21 +84,53 @@ static MotorController motor(pinMotorPwm,pinMotorDir,pinMotorPwr);
 static PButton b1(pinB1);                        //CW button
 static PButton b2(pinB2);                        //CCW button
 static PButton b3(pinB3);                        //Auto/Cancel button sets/clears autoRun flag
-static PTimer  b3t = PTimer(BHMS);               //User must press b3 this many ms to "hold" it
-static PTimer  art = PTimer(ARMS);               //Autorun duration (how long the drum rotates)
+static PShortFixedTimer<BHMS> b3t;               //User must press b3 this many ms to "hold" it
+static PFixedTimer<ARMS/AUTOPULSES> art;         //Autorun pulse duration (how long the drum rotates each time)
+static PFixedTimer<PULSERESTMS> prt;             //Rest between autorun pulses
 static LED lowBattery = LED(pinDisLED);          //The Low (discharged) Battery LED
 static LED highBattery = LED(pinOvrLED);         //The High (overcharged) Battery LED
 static LED scheduled = LED(pinSkedLED);          //The Autorun Scheduled LED
 static SoundMaker audio = SoundMaker(pinAudio);  //The speaker
+static PUsb usb = PUsb();                        //Attaches serial logging when a USB host appears
+#if TELEMETRY==1
+static PTelemetry telemetry(TELEMS);             //Binary status frames for the host (see doTelemetry())
+#endif
+
+
+//Periodic work, each at the rate it needs rather than once per pass through loop()
+static void doButtonsTask() { b1.update(); b2.update(); b3.update(); }
+static void doMotorTask()   { motor.update(); b3t.update(); art.update(); prt.update(); }
+static void doBatteryTask() { Battery::hold(!motor.isStopped()); Battery::update(); }
+static void doLedsTask() {
+  lowBattery.set(Battery::isLow());                 //Battery discharged?
+  highBattery.set(Battery::isHigh());               //Battery Overcharged?
+  scheduled.set(sked.enabled());                    //Autorun scheduler enabled?
+}
+static void doClockTask()   { sked.update(); }
+
+static PTask taskTable[] = {
+  //name       run             period ms  budget us  due, overruns
+  {"buttons",  doButtonsTask,      5,        300,     0, 0},
+  {"motor",    doMotorTask,       10,        500,     0, 0},
+  {"battery",  doBatteryTask,   1000,       1000,     0, 0},  //One conversion, plus 25 ADC clocks after power-up
+  {"leds",     doLedsTask,      1000,        300,     0, 0},  //Runs after "battery" so it sees the new sample
+  {"clock",    doClockTask,    60000,      10000,     0, 0}   //Hourly, one I2C transfer with the rtc and an EEPROM write of two cells
+};
+static PScheduler tasks(taskTable, sizeof(taskTable) / sizeof(taskTable[0]));
 
 
 //Composter state variable.  The FSM analyzes the control panel button activity.
 static comState state;                           //This is the FSM's state var
+static byte pulsesLeft;                          //Autorun pulses still to run after the current one
+static bool pulseDir;                            //Direction of the current autorun pulse
 
 //As a developer, I need to know the average time spent in the loop() code so I can optimize power usage
 static long  totalLoopTime;                          //milliseconds in loop()
 static long  nTimesLoopInvoked;                      //Counts invocations of loop()
 
+static volatile bool buttonWoke;                     //A button interrupt has occurred (see intHan())
+static bool diagShown;                               //Statistics printed for this B1+B2 press
+
 //------------------------------------------------------------------------------------------------------
 //  The arduino kernel invokes setup() to initialize the composter controller
 //------------------------------------------------------------------------------------------------------
@@ -96,31 +144,30 @@ void setup() {
   //Initial machine state following arduino reset
   state=IDL;                              //Initial state is IDL
 
-  //Try upto 3 times to detect a USB-connected host to our arduino 32U4 CPU.  After
-  //each failing attempt to detect SerialUSB ready, we beep and blink all the LEDs
-  Serial.begin(57600);
-  for(int i=1;(i<=3)&&(!SerialUSB);i++) {
-    audio.doBeep(FREQG);
-    lowBattery.doOn();
-    highBattery.doOn();
-    scheduled.doOn();
-    delay(1000);      
-    lowBattery.doOff();
-    highBattery.doOff();
-    scheduled.doOff();
-    delay(100);                    
-  }
+  //Watch for a USB host in the background rather than waiting for one.  Brownout resets are
+  //frequent in winter, so booting must reach loop() quickly.
+  usb.begin();
+
+  //Power-down the on-chip peripherals until a subsystem needs them
+  PPower::begin();
+  audio.doClick();                        //Let the user hear that we've booted
+
+  //Slow the CPU to 2 MHz until a subsystem needs full speed
+  PClock::begin();
 
   //Setup interrupt handlers so buttons will awaken processor from a nap
   attachInterrupt(digitalPinToInterrupt(pinB1),intHan,CHANGE);
   attachInterrupt(digitalPinToInterrupt(pinB2),intHan,CHANGE);
   attachInterrupt(digitalPinToInterrupt(pinB3),intHan,CHANGE);
 
+  //Pick up the statistics where we left off
+  Stats::load();
+
   //Startup the composter's autorun scheduler
   sked.start(); 
 
-   //Log the startup time
-   LOG(("Start on "+String(rtc.getMonth())+"/"+rtc.getDate()+"/"+rtc.getYear()+" at "+String(rtc.getHour())+":"+String(rtc.getMinute())+":"+rtc.getSecond()));                     
+  //Hold B1 and B2 while booting to benchmark the board
+  if (Benchmark::isRequested(pinB1, pinB2)) doBenchmark();
 
 }
 
@@ -131,24 +178,34 @@ void loop() {
 
   //The loop-timing feature is for software developers, not the end-user of the composter
   long t0 = millis();                             //Time at start of a pass through loop()
+  comState passState = state;
+  if (Benchmark::isOn()) Benchmark::startPass();  //...and finer, for the benchmark
   
-  //Poll and Update the status of objects that won't get updated otherwise
-  b3t.update();
-  art.update();
-  motor.update();
-  sked.update();
+  //Greet a USB host when one connects
+  if (usb.update()) doLogStart();
 
-  //Update the LEDs as appropriate
-  lowBattery.set(Battery::isLow());                 //Battery discharged?
-  highBattery.set(Battery::isHigh());               //Battery Overcharged?
-  scheduled.set(sked.enabled());                    //Autorun scheduler enabled?
-  delay(5L);                                        //Ensure the LEDs flash for a few ms
+  //Poll and Update the status of objects that are due (buttons, timers, motor, battery, LEDs, rtc)
+  tasks.runDue();
+  if (state==NAP) delay(5L);                        //Ensure the LEDs flash for a few ms after a nap
 
   //Press *both* buttons b1 and b2 for diagnostic information
   if (b1.isPressed()&&b2.isPressed()) {
     if (nTimesLoopInvoked>0) {DPRINT(String("Avg loop time = "+String(totalLoopTime/nTimesLoopInvoked)+" ms"));}
     DPRINT(String("State="+state));
+    DPRINT(String("Task overruns="+String(tasks.getOverruns())));
+    DPRINT(String("Autorun at "+String(sked.getStartSecond()/3600L)+":"+String(sked.getStartSecond()/60L%60L)));
+    DPRINT(String("Standby hold="+String(motor.getStandby().getHoldMs())+" ms, hits="+String(motor.getStandby().getHits())+", misses="+String(motor.getStandby().getMisses())));
+    if (!diagShown && usb.isConnected()) {
+      Stats::print();
+      if (Benchmark::isOn()) Benchmark::printPasses(stateNames, sizeof(stateNames) / sizeof(stateNames[0]));
+    }
+    diagShown = true;
+  } else {
+    diagShown = false;
   }
+
+  //Close a spell of naps once there's something to do
+  if (state!=NAP) Stats::active();
   
   //Composter state determines what to do with incoming events
   switch(state) {
@@ -157,11 +214,13 @@ void loop() {
     case IDL:
       if (b1.isPressed()) {
         DPRINT("b1");
+        Stats::count(STSTARTB1);
         audio.doClick();
         motor.start(MCW);
         state=RCW;
       } else if (b2.isPressed()) {
         DPRINT("b2");
+        Stats::count(STSTARTB2);
         audio.doClick();
         motor.start(MCCW);
         state=RCC;
@@ -171,7 +230,11 @@ void loop() {
         state=B3W;                  //Will wait to see if B3 will be held
         b3t.start();                //Start the B3 timer
       } else if (sked.isTimeToStart()) {
+        Stats::count(STSTARTSKED);
         doStartMotor();             //Start the motor
+      } else if (sked.isTimeForSurplus()) {
+        Stats::count(STSTARTSURPLUS);
+        doSurplusRun();             //Put the overcharged battery's surplus to work
       } else {                      //Composter is inactive 
         if (nap.isIdleTimerExpired()) {             //If the inactive interval timer has expired then put the processor to sleep
           doNap();
@@ -190,11 +253,13 @@ void loop() {
         doNap();                                  //Return to anp
         return;                     //Force re-entry of loop()
       } else if (b1.isPressed()) {
+        Stats::count(STSTARTB1);
         audio.doClick();
         motor.start(MCW);
         state=RCW;
       } else if (b2.isPressed()) {
         DPRINT("b2 fm nap");
+        Stats::count(STSTARTB2);
         audio.doClick();
         motor.start(MCCW);
         state=RCC;
@@ -204,7 +269,11 @@ void loop() {
         state=B3W;                  //Will wait to see if B3 will be held
         b3t.start();                //Start the B3 timer
       } else if (sked.isTimeToStart()) {
+        Stats::count(STSTARTSKED);
         doStartMotor();
+      } else if (sked.isTimeForSurplus()) {
+        Stats::count(STSTARTSURPLUS);
+        doSurplusRun();
       } else if (b1.isStable()&&b2.isStable()&&b3.isStable()) {
         DPRINT("Nothing to do here"); //No button activity pending
         doNap();                      //Probably WDT awoke us.  Put the composter down for a nap
@@ -232,13 +301,18 @@ void loop() {
       }
     break;
 
-    //Any button activity or the autorun timer will stop autorunning
+    //Any button activity will stop autorunning.  The end of a pulse rests before the next, if any.
     case ARN:
-      if (b1.isPressed()||b2.isPressed()||b3.isPressed()||art.isExpired()) {
+      if (b1.isPressed()||b2.isPressed()||b3.isPressed()||(art.isExpired()&&pulsesLeft==0)) {
         DPRINT("~arn");
         audio.doClick();
         motor.stop();         //Stop the motor
         state=DCL;            //Decelerate to stop
+      } else if (art.isExpired()) {
+        DPRINT("arn rest");
+        motor.stop();         //Decelerate, then rest
+        prt.start();
+        state=ARP;
       }
 
     //Decelerating:  Ignore all events until motor controller decels motor to a stop, then become idle
@@ -249,11 +323,29 @@ void loop() {
       }
     break;
 
+    //Resting between autorun pulses.  Any button activity ends the autorun.
+    case ARP:
+      if (b1.isPressed()||b2.isPressed()||b3.isPressed()) {
+        DPRINT("~arp");
+        audio.doClick();
+        prt.reset();
+        state=DCL;            //Wait for the motor to come to rest, if it hasn't already
+      } else if (prt.isExpired()&&motor.isStopped()) {
+        DPRINT("arp pulse");
+        pulsesLeft--;
+        pulseDir = !pulseDir; //Alternate the direction so the drum works back and forth
+        motor.start(pulseDir);
+        art.start();
+        state=ARN;
+      }
+    break;
+
     //Awaiting B3 tapped/held decision to determine if user enabled/disabled autoRun
     case B3W:
       if (b3.isReleased()&&b3t.isRunning()) {       //Did user tap B3?
         DPRINT("B3 tapped");
         sked.setStartTime();                        //Set now as the start time & enable the daily composter autoRun
+        Stats::count(STSTARTB3);
         doStartMotor();                             //And start an autorun sequence right now
       } else if (b3.isPressed()&&b3t.isExpired()) {  //Did user hold B3?
         DPRINT("B3 held");
@@ -278,6 +370,14 @@ void loop() {
   long t1 = millis();                               //Time when loop() finished
   totalLoopTime += (t1 - t0);                       //Sum time in ms
   nTimesLoopInvoked++;                              //Count invocations
+  if (Benchmark::isOn()) Benchmark::pass(passState);
+
+#if TELEMETRY==1
+  if (usb.isConnected() && telemetry.isDue()) doTelemetry(t1 - t0);
+#endif
+
+  //Doze until the next task is due rather than spinning
+  while (!tasks.isDue()) nap.doze();
     
 }
 
@@ -287,43 +387,132 @@ void loop() {
 void doNap() {
   DPRINT("doNap");      
 
-  //Don't sleep the processor if battery is overcharged
-  if (!Battery::isHigh()) {
+  Stats::save();                              //Once a day, while nothing is waiting on us
 
-    state=NAP;                                //When we awaken, we'll need to know what we were doing
+  //Nap even if the battery is overcharged.  Its surplus goes into extra pulses instead (see Schedule.cpp).
+  state=NAP;                                  //When we awaken, we'll need to know what we were doing
 
-    //Snuff the LEDs to save power.  They'll light up momentarily in loop()
-    lowBattery.doOff();
-    highBattery.doOff();
-    scheduled.doOff();
+  //Snuff the LEDs to save power.  They'll light up momentarily in loop()
+  lowBattery.doOff();
+  highBattery.doOff();
+  scheduled.doOff();
 
-    //Now place CPU down for a nap
-    nap.resetIdleTimer();                     //Reset the idle timer and...
-    nap.sleepNow();                           //Put the CPU down for a nap to save power.
-    
-   }
+  //Now place CPU down for a nap
+  nap.resetIdleTimer();                       //Reset the idle timer and...
+  Stats::sleeping();
+  buttonWoke = false;
+  nap.sleepNow();                             //Put the CPU down for a nap to save power.
+  Stats::woke(buttonWoke);
+  sked.napped(!buttonWoke);                   //millis() stood still, so tell the clock...
+  tasks.makeAllDue();                         //...and bring everything else up to date
 }
 
 
 /**
- * Helper method to start the drum motor and enter the autorunning state
+ * Helper method to start the drum motor and enter the autorunning state.  The first pulse is CCW.
  */
 void doStartMotor() {
         DPRINT("doStartMotor");
-        motor.start(MCCW);           //Start the motor
-        art.start();                //Start the timer that ends autorun
+        pulsesLeft = AUTOPULSES - 1;  //Pulses to follow this one
+        pulseDir = MCCW;
+        motor.start(pulseDir);       //Start the motor
+        art.start();                //Start the timer that ends this pulse
         state=ARN;                  //Autorunning state
         sked.setFinished();         //Tell sked we ran the composter today
 }
 
 
+/**
+ * Helper method to turn the drum for one extra pulse on an overcharged battery's surplus.  Successive pulses
+ * alternate direction, and the autorun isn't counted as done.
+ */
+void doSurplusRun() {
+        DPRINT("doSurplusRun");
+        pulsesLeft = 0;             //Just the one pulse
+        pulseDir = !pulseDir;
+        motor.start(pulseDir);
+        art.start();                //Start the timer that ends this pulse
+        state=ARN;                  //Autorunning state
+        sked.setSurplusRun();       //Tell sked when, and how much motor time it spent
+}
+
+
+/**
+ * Helper method for benchmark mode.  Waits for a USB host to report to, runs the benchmark, then waits for
+ * B1 and B2 to be released so they don't jog the drum.
+ */
+void doBenchmark() {
+  while (!usb.isConnected() && millis() < BENCHUSBMS) {
+    usb.update();
+    delay(10);
+  }
+  if (usb.isConnected()) {
+    doLogStart();
+    Benchmark::run(motor);
+  }
+  while (digitalRead(pinB1) == PRESSED || digitalRead(pinB2) == PRESSED) delay(10);
+}
+
+
+/**
+ * Helper method to log the startup banner and the statistics when a USB host connects
+ */
+void doLogStart() {
+  LOG(("Start on "+String(rtc.getMonth())+"/"+rtc.getDate()+"/"+rtc.getYear()+" at "+String(rtc.getHour())+":"+String(rtc.getMinute())+":"+rtc.getSecond()));
+  Stats::print();
+}
+
+
+#if TELEMETRY==1
+/**
+ * Helper method to send a status frame to the USB host.  Frame type 1 (decoded by ComposterTelemetry):
+ *
+ *   offset  size  field
+ *     0      1    type (1)
+ *     1      1    sequence number
+ *     2      4    millis()
+ *     6      1    comState
+ *     7      1    MotorState
+ *     8      1    motor speed (PWM duty)
+ *     9      2    battery voltage x10 (Battery::getVoltage())
+ *    11      1    timers:  bit0 b3t active, bit1 art active, bit2 idle timer active, bit3 autorun enabled
+ *    12      2    duration of the last pass through loop() (ms)
+ *    14      2    average duration of a pass through loop() (ms)
+ *    16      2    motor controller standby hold (ms)
+ *    18      2    standby hits (restarts that found the controller powered)
+ *    20      2    standby misses (restarts that cycled the relay after a gap cheaper to hold through)
+ *    22      2    scheduled task overruns
+ *
+ * Fields are only ever appended, so a decoder can ignore those it doesn't know.
+ */
+void doTelemetry(long passMs) {
+  byte timers = (b3t.isActive() ? 1 : 0) | (art.isActive() ? 2 : 0) |
+                (nap.isIdleTimerActive() ? 4 : 0) | (sked.enabled() ? 8 : 0);
+  telemetry.begin(1);
+  telemetry.put32(millis());
+  telemetry.put(state);
+  telemetry.put(motor.getState());
+  telemetry.put(motor.getSpeed());
+  telemetry.put16(Battery::getVoltage());
+  telemetry.put(timers);
+  telemetry.put16(passMs);
+  telemetry.put16(totalLoopTime / nTimesLoopInvoked);
+  telemetry.put16(motor.getStandby().getHoldMs());
+  telemetry.put16(motor.getStandby().getHits());
+  telemetry.put16(motor.getStandby().getMisses());
+  telemetry.put16(tasks.getOverruns());
+  telemetry.send();
+}
+#endif
+
+
 /*
- * Do nothing interrupt handler.  Button interrupts are enabled only to arrange for buttons to
- * awaken the processor from a nap.
+ * Button interrupt handler.  Button interrupts are enabled only to arrange for buttons to
+ * awaken the processor from a nap.  The flag tells the statistics what woke us.
  * 
  */
  void intHan() {
-
+  buttonWoke = true;
  }
 
 
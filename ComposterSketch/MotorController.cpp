@@ -7,7 +7,12 @@
  * particular direction, and stop the motor.
  * 
  * we start/stop the motor somewhat slowly to prevent damage to the mechanical drive
- * train.  The accel/decel feature is implemented here.
+ * train.  The accel/decel feature is implemented here.  The speed steps come from timer1's
+ * overflow interrupt rather than from update(), so a blocking beep or a slow pass through
+ * loop() can't stall a ramp and the processor can doze between steps.  Timer1 is the natural
+ * pacer:  it already generates the motor's PWM and is powered whenever the controller is.
+ * (Timer3 is taken by tone().)  update() just finishes up when the interrupt reports that a
+ * stop has been reached.
  * 
  * This implementation was developed for a Robot Shop RB-Cyt-133 30A 5-30V Single Brushed
  * DC Motor Driver.  See:  http://www.robotshop.com/en/30a-5-30v-single-brushed-dc-motor-driver.html 
@@ -19,6 +24,9 @@
  * needed.  We provide a brief delay after powering-up the controller for the relay to settle and
  * the controller's logic to initialize before we start the motor.
  *
+ * How long the controller stays powered after the motor stops is chosen by a StandbyPolicy that learns
+ * from recent usage, so jogging with B1/B2 doesn't cycle the relay between every press.
+ *
  ******************************************************************************************************************/
 
 #include "Arduino.h"
@@ -26,7 +34,17 @@
 #include "PDebug.h"
 #include "MotorController.h"
 #include "Battery.h"
+#include "PPower.h"
+#include "Stats.h"
+
 
+MotorController *MotorController::ramping = 0;
+byte MotorController::rampTicks = 0;
+
+//Timer1 overflows at the bottom of each PWM cycle
+ISR(TIMER1_OVF_vect) {
+  MotorController::rampTick();
+}
 
 /**
  * Constructor needs to know the three pins for controlling the motor
@@ -35,11 +53,15 @@
  * arelayPin - arduino digital pin (or 0 if none) assigned to power-up/down the motor controller
  */
 MotorController::MotorController(byte apwmPin, byte adirPin, byte arelayPin) : 
-  timer1(TIMER1_MS), timer2(MCMS) {
+  timer2(MCMS), standby(MCMS, MCCYCLEMS, MCMSMAX, MCJOGMS) {
 	pwmPin = apwmPin;
 	dirPin = adirPin;
 	relayPin = arelayPin;
 	state = MOTORSTANDBY;
+  currentSpeed = 0;
+  rampDelta = 0;
+  rampDone = true;
+  wakeOnly = false;
 	pinMode(pwmPin,OUTPUT);			//Config PWM pin for output.
 	pinMode(dirPin,OUTPUT);			//Config motor direction pin for output.
 	if (arelayPin != 0) pinMode(relayPin,OUTPUT);
@@ -58,6 +80,7 @@ MotorController::MotorController(byte apwmPin, byte adirPin, byte arelayPin) :
   //Ignore attempts to start motor when battery voltage is low
   if (Battery::isLow()) {
     DPRINT("start ignored --- vBat low");
+    Stats::count(STREFUSED);
     return;
   }
 
@@ -66,11 +89,9 @@ MotorController::MotorController(byte apwmPin, byte adirPin, byte arelayPin) :
   switch(state) {
     //Motor controller must be awakened from standby before use.
     case MOTORSTANDBY:
-      state = MOTORAWAKENING;
-      DPRINT("MOTORAWAKENING");
+      standby.started(false);         //The relay had to cycle
       dir = direction;                //Record new motor direction
-      digitalWrite(relayPin,HIGH);    //Start the controller awakening
-      timer1.start();                 //Motor will start after timer expires
+      awaken();                       //Motor will start once the controller is awake
       break;
     //Waiting for timer1 to expire before starting motor
     case MOTORAWAKENING:
@@ -79,6 +100,7 @@ MotorController::MotorController(byte apwmPin, byte adirPin, byte arelayPin) :
     //Start the motor immediately as it's not currently running.
     case MOTORSTOPPED:
     DPRINT("start Starting");
+      standby.started(true);          //Caught while the controller was held
       dir = direction;                //New motor direction
       startMotor();                   //Starts motor immediately and changes state to MOTORRUNNING
       break;
@@ -90,11 +112,24 @@ MotorController::MotorController(byte apwmPin, byte adirPin, byte arelayPin) :
   }
  }
 
+ /**
+  * Benchmark only:  awaken the controller from standby through MOTORAWAKENING, then return it to standby as soon as
+  * it reaches MOTORSTOPPED, without starting the motor.  Nothing is counted in Stats or taught to StandbyPolicy.
+  * Returns false (doing nothing) unless the controller is in standby.
+  */
+ bool MotorController::wake() {
+  update();
+  if (state != MOTORSTANDBY) return false;
+  wakeOnly = true;
+  awaken();
+  return true;
+ }
+
  /**
   * Decelerate and stop the motor
   * 
   * To avoid damage to the drive train, we always decel the motor slowly using
-  * timer1 to pace the speed reduction steps.
+  * timer1's overflow interrupt to pace the speed reduction steps.
   */
   void MotorController::stop() {
     DPRINT("stop");
@@ -102,17 +137,17 @@ MotorController::MotorController(byte apwmPin, byte adirPin, byte arelayPin) :
 
     switch(state) {
 
-      //If the motor is awakening then we'll need to clean things up before decel begins
+      //If the motor is awakening then it never started.  There's no run to ramp down or record.
       case MOTORAWAKENING:
-        timer1.reset();                                   //Stop the awakening timer then fall thru to MOTORRUNNING
+        timer1.reset();                                   //Stop the awakening timer
+        wakeOnly = false;
+        hold();                                           //Hold the controller as after any stop
+        break;
 
-      //Begin decelerating (which continues in update())
+      //Begin decelerating (update() finishes up when the interrupt reaches a stop)
       case MOTORRUNNING:
         state = MOTORSTOPPING;                            //Enter the deceleration state
-        currentSpeed -= ACCEL_STEP_SIZE;                  //Slower speed
-        if (currentSpeed < 0) currentSpeed = 0;           //Min speed is 0
-        analogWrite(pwmPin,currentSpeed);                 //Slow it down
-        timer1.start();                                   //Timer1 informs update() when speed can be further reduced
+        ramp(-ACCEL_STEP_SIZE);                           //Slow it down, even if it's still accelerating
         break;
         
       //Sometimes, there's nothing to do
@@ -142,42 +177,33 @@ MotorController::MotorController(byte apwmPin, byte adirPin, byte arelayPin) :
       if (timer1.isExpired()) {
         DPRINT("M update");
         state = MOTORSTOPPED;       //Timer has expired.  Motor is now stopped and ready to start.
-        startMotor();               //Start the motor
+        if (wakeOnly) {             //Only awakened for the benchmark?
+          wakeOnly = false;
+          enterStandby();
+        } else {
+          startMotor();             //Start the motor
+        }
       }
     break;
 
     //Motor is ready for use but no request has been made for it to run.  Shall we put it to sleep or keep waiting for something to do?
     case MOTORSTOPPED:
       if (timer2.isExpired()) {         //Can we enter standby mode yet to save power?
-        digitalWrite(relayPin,LOW);     //Yes, Power-down the motor controller
-        state = MOTORSTANDBY;           //The motor is officially asleep to save power
+        enterStandby();                 //Yes, power-down the motor controller
       }
     break;
 
-    //Motor is accelerating or running in direction indicated by instance variable, dir
+    //Motor is accelerating or running in direction indicated by instance variable, dir.  The interrupt does the accelerating.
     case MOTORRUNNING:
-      if (timer1.isExpired()) {
-        int newSpeed = currentSpeed + ACCEL_STEP_SIZE;
-        currentSpeed = (newSpeed>MOTOR_MAX_SPEED) ? MOTOR_MAX_SPEED : newSpeed;
-        DPRINT(currentSpeed);
-        analogWrite(pwmPin,currentSpeed);
-        timer1.start();
-      }
     break;
 
-    //Motor is decelerating to a stop.  Either slow it further or bring it to a stop.
+    //Motor is decelerating to a stop.  Once the interrupt has brought it to rest, decide how long to hold the controller.
     case MOTORSTOPPING:
-      if (timer1.isExpired()) {                           //Time to slow it some more?
-        if (currentSpeed >= ACCEL_STEP_SIZE ) {           //Are we still slowing it down?
-          currentSpeed -= ACCEL_STEP_SIZE;                //Yes, calc slower speed
-          timer1.start();                                 //Timer1 notifies update() when we can slow it more
-        } else {
-          currentSpeed=0;                             //Stop the motor
-          state=MOTORSTOPPED;
-          timer2.start();                             //Start the standby timer             
-        }
-        DPRINT(currentSpeed);
-        analogWrite(pwmPin,currentSpeed);           //Slow down the motor
+      if (rampDone) {
+        DPRINT("M stopped");
+        Stats::record(SHRUN, millis() - runSince);
+        standby.stopped(millis() - runSince);       //Start measuring the idle gap
+        hold();
       }
     break;
   }
@@ -189,6 +215,16 @@ MotorController::MotorController(byte apwmPin, byte adirPin, byte arelayPin) :
   return state;
  }
 
+ //Get the motor's current speed (PWM duty)
+ byte MotorController::getSpeed() {
+  return currentSpeed;
+ }
+
+ //Get the standby policy (hold time and hit/miss statistics)
+ StandbyPolicy &MotorController::getStandby() {
+  return standby;
+ }
+
  //Is motor running?
  bool MotorController::isRunning() {
   return (state==MOTORRUNNING)||(state==MOTORAWAKENING);
@@ -199,6 +235,33 @@ MotorController::MotorController(byte apwmPin, byte adirPin, byte arelayPin) :
   return (state==MOTORSTOPPED)||(state==MOTORSTANDBY);
  }
 
+//Private method to start the controller awakening from standby
+void MotorController::awaken() {
+  state = MOTORAWAKENING;
+  DPRINT("MOTORAWAKENING");
+  PPower::acquire(PWRTIMER1);           //Timer1 generates the PWM while the controller is powered
+  digitalWrite(relayPin,HIGH);          //Start the controller awakening
+  timer1.start();                       //Ready once the timer expires
+}
+
+//Private method to hold the stopped motor's controller powered for as long as recent usage suggests
+void MotorController::hold() {
+  state = MOTORSTOPPED;
+  if (standby.getHoldMs() > 0) {
+    timer2.setDuration(standby.getHoldMs());
+    timer2.start();                     //Start the standby timer
+  } else {
+    enterStandby();                     //Recent usage says don't hold at all
+  }
+}
+
+//Private method to power-down the motor controller.  The motor must be stopped.
+void MotorController::enterStandby() {
+  digitalWrite(relayPin,LOW);           //Power-down the motor controller
+  PPower::release(PWRTIMER1);           //No more PWM until the controller is awakened again
+  state = MOTORSTANDBY;                 //The motor is officially asleep to save power
+}
+
 //Private method for starting the motor.  Motor must currently be stopped.
 //New state will become MOTORRUNNING.  Motor will begin accelerating in the requested direction.
 void MotorController::startMotor() {
@@ -210,8 +273,10 @@ void MotorController::startMotor() {
       state = MOTORRUNNING;                 //Motor is now running
       digitalWrite(dirPin,dir);             //Program controller with requested direction
       currentSpeed = MOTOR_STARTING_SPEED;  //Start the motor at this speed
+      runSince = millis();                  //Run length tells StandbyPolicy jogging from autorunning
+      Stats::record(SHVSTART, Battery::getSampled());
       analogWrite(pwmPin,currentSpeed);     //Program pwm with the current speed
-      timer1.start();                       //Timer informs us when speed can be increased
+      ramp(ACCEL_STEP_SIZE);                //Interrupt accelerates it to MOTOR_MAX_SPEED
       break;
     //Motor cannot be started while in invalid states
     default:      
@@ -220,3 +285,34 @@ void MotorController::startMotor() {
   
  }
 
+//Private method to start (or redirect) a ramp.  Every RAMP_OVERFLOWS overflows of timer1, rampTick() changes the
+//speed by delta until it reaches MOTOR_MAX_SPEED or zero.  Timer1 must be powered (it is while the controller is).
+void MotorController::ramp(int delta) {
+  uint8_t oldSREG = SREG;
+  cli();
+  rampDelta = delta;
+  rampDone = false;
+  rampTicks = 0;
+  ramping = this;
+  TIFR1 = (1 << TOV1);                  //Discard a stale overflow so the first step is a full period away
+  TIMSK1 |= (1 << TOIE1);
+  SREG = oldSREG;
+}
+
+/**
+ * Take the next ramp step when it's due.  Runs in timer1's overflow interrupt.
+ */
+void MotorController::rampTick() {
+  MotorController *m = ramping;
+  if (m == 0 || ++rampTicks < RAMP_OVERFLOWS) return;
+  rampTicks = 0;
+  int speed = m->currentSpeed + m->rampDelta;
+  if (speed >= MOTOR_MAX_SPEED || speed <= 0) {   //End of the ramp?
+    speed = speed > 0 ? MOTOR_MAX_SPEED : 0;
+    TIMSK1 &= ~(1 << TOIE1);                      //No more steps until the next ramp
+    ramping = 0;
+    m->rampDone = true;                           //Tell update()
+  }
+  m->currentSpeed = speed;
+  analogWrite(m->pwmPin, speed);
+}
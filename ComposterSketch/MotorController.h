@@ -6,6 +6,7 @@
  */
 #include "Arduino.h"
 #include "PTimer.h"
+#include "StandbyPolicy.h"
 #ifndef MOTORCONTROLLER_H_
 #define MOTORCONTROLLER_H_
 
@@ -18,7 +19,8 @@
 #define ACCEL_STEP_SIZE       5     //PWM increment/decrement for accel/decl motor
 
 //Define the time-out intervals
-#define TIMER1_MS   10L             //Used for awakening the controller and between speed adjustments     
+#define TIMER1_MS   10L             //Used for awakening the controller
+#define RAMP_OVERFLOWS  5           //Timer1 overflows (2.04 mS apart at 490 Hz) between speed adjustments
 
 //Motor direction
 #define MCW  true                    //Clockwise
@@ -38,19 +40,34 @@ private:
 	byte dirPin;	        //Direction pin controls motor's rotation direction
 	byte relayPin;        //Relay pin powers-up the motor controller when needed
 	MotorState state;     //Motor Controller object's state
-  byte currentSpeed;    //The motor's current speed (255 == full throttle)
+  volatile byte currentSpeed;   //The motor's current speed (255 == full throttle)
+  volatile int rampDelta;       //Speed change per ramp step (+accel, -decel)
+  volatile bool rampDone;       //Set by the interrupt when the ramp reaches full speed or a stop
   bool dir;             //The motor's direction if running
-  PTimer timer1;        //Provides delay for speed adjustments and awakening from standby
+  PShortFixedTimer<TIMER1_MS> timer1;  //Provides delay for awakening from standby
   PTimer timer2;        //Provides long delay for placing controller in standby when drum is idle
+  StandbyPolicy standby;  //Chooses timer2's duration from recent usage
+  unsigned long runSince; //millis() when the motor last started
+  bool wakeOnly;        //Awakening for the benchmark:  return to standby instead of starting the motor
+  void awaken();        //Powers-up the controller from standby
   void startMotor();    //Accelerates motor from stop to MOTOR_MAX_SPEED
+  void hold();          //Holds the stopped motor's controller powered, or powers it down
+  void enterStandby();  //Powers-down the controller
+  void ramp(int);       //Has timer1's overflow interrupt step the speed by the given amount
+  static MotorController *ramping;  //The controller whose speed the interrupt is stepping, if any
+  static byte rampTicks;            //Overflows since the last step
 public:
 	MotorController(byte,byte,byte);
 	bool isRunning();
   bool isStopped();
 	void stop();
 	void start(bool);
+  bool wake();            //Benchmark only:  awaken the controller without starting the motor
   void update();
   MotorState getState();
+  byte getSpeed();        //Current PWM duty (0..255)
+  StandbyPolicy &getStandby();  //Standby hold time and hit/miss statistics
+  static void rampTick(); //Called from timer1's overflow interrupt
 };
 
 #endif /* MOTORCONTROLLER_H_ */
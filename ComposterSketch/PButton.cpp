@@ -17,11 +17,10 @@
 
 //#define DPRINT(x)
 
-PButton::PButton(byte n) : debounceTimer(PBUTTON_DEBOUNCE_MS) {
+PButton::PButton(byte n) {
 	pin = n;                        //Arduino pin number
 	pinMode(pin,INPUT_PULLUP);			//Button electrical contacts need a pull-up resistor
   state = PBR;                    //Buttons initialize in the released state
-  debounceTimer = PTimer(PBUTTON_DEBOUNCE_MS);    //Timer used to debounce noisy button contact
 }
 
 //Public method to update timer status (debounce logic is in this method)
@@ -33,7 +33,7 @@ public:
 private:
   byte pin;
   PButtonState state;
-  PTimer debounceTimer;  //C++ Uniform Initialization of member variable debounceTimer
+  PShortFixedTimer<PBUTTON_DEBOUNCE_MS> debounceTimer;  //Timer used to debounce noisy button contact
 };
 
 #endif /* PBUTTON_H_ */
@@ -0,0 +1,100 @@
+/******************************************************************************************************************
+ * PClock.cpp --- Reference-counted scaling of the CPU clock
+ *
+ * The 32U4's system clock prescaler (clock_prescale_set() in avr/power.h) divides the 16 MHz crystal down
+ * to 2 MHz, cutting the core's awake current by roughly a factor of five.  Everything that was set up for
+ * 16 MHz by the Arduino core is rescaled with it so that the rest of the sketch can't tell:
+ *
+ *  timer0    millis(), delay() and PTimer   /64 -> /8, still a 1.024 ms overflow
+ *  timer1    Motor PWM on pin 9             /64 -> /8, still 490 Hz phase-correct PWM
+ *  ADC       Battery voltage                /128 -> /16, still a 125 kHz ADC clock
+ *  TWI       DS1307 rtc                     TWBR 72 -> 2, still 100 kHz SCL
+ *
+ * Notes:  A peripheral's registers can't be written while PPower has its clock stopped, so PPower calls tune()
+ * each time it powers one up.
+ * tone() computes its prescaler from F_CPU on every call, and USB servicing needs the full clock, so
+ * SoundMaker and PUsb hold the fast clock while they work.
+ * delayMicroseconds() is a calibrated busy-loop and runs 8 times long on the slow clock.  Nothing here uses it.
+ *
+ ******************************************************************************************************************/
+
+#include "Arduino.h"
+#include <avr/power.h>
+#include "Composter.h"
+#include "PDebug.h"
+#include "PClock.h"
+
+#define SLOWDIV       clock_div_8                       //16 MHz / 8 == 2 MHz
+#define TWIFREQ       100000L                           //Wire's SCL frequency
+#define TWBRFAST      (((F_CPU / TWIFREQ) - 16) / 2)    //As set by Wire.begin()
+#define TWBRSLOW      (((F_CPU / 8 / TWIFREQ) - 16) / 2)
+#define CSMASK        0x07                              //Clock select bits of TCCRnB and ADPS bits of ADCSRA
+
+byte PClock::holds = 0;
+bool PClock::fast = true;                               //The fuses start us at 16 MHz
+
+
+/**
+ * Drop to the slow clock unless a subsystem has already acquired the fast one
+ */
+void PClock::begin() {
+  if (holds == 0) setSpeed(false);
+}
+
+
+/**
+ * Hold the full 16 MHz clock, speeding up if nobody else already holds it
+ */
+void PClock::acquire() {
+  if (holds++ == 0) setSpeed(true);
+}
+
+
+/**
+ * Drop a hold on the fast clock, slowing down if this was the last one
+ */
+void PClock::release() {
+  if (holds == 0) return;                               //Unbalanced release.  Ignore it.
+  if (--holds == 0) setSpeed(false);
+}
+
+
+//Is the CPU running at 16 MHz?
+bool PClock::isFast() {
+  return fast;
+}
+
+
+/**
+ * Set a peripheral's prescaler for the current CPU clock.  Called by PPower when it powers one up.
+ */
+void PClock::tune(PPeripheral p) {
+  switch (p) {
+    case PWRADC:
+      ADCSRA = (ADCSRA & ~CSMASK) | (fast ? 7 : 4);     //ADC clock / 128 or / 16
+      break;
+    case PWRTWI:
+      TWBR = fast ? TWBRFAST : TWBRSLOW;
+      break;
+    case PWRTIMER1:
+      TCCR1B = (TCCR1B & ~CSMASK) | (fast ? (1 << CS11) | (1 << CS10) : (1 << CS11));
+      break;
+    default:
+      break;
+  }
+}
+
+
+//Private method to switch the CPU clock and rescale everything that depends on it.  Interrupts are held off
+//so that timer0 never ticks at the wrong rate.
+void PClock::setSpeed(bool toFast) {
+  byte sreg = SREG;
+  cli();
+  fast = toFast;
+  clock_prescale_set(fast ? clock_div_1 : SLOWDIV);
+  TCCR0B = (TCCR0B & ~CSMASK) | (fast ? (1 << CS01) | (1 << CS00) : (1 << CS01));
+  if (PPower::isPowered(PWRADC)) tune(PWRADC);
+  if (PPower::isPowered(PWRTWI)) tune(PWRTWI);
+  if (PPower::isPowered(PWRTIMER1)) tune(PWRTIMER1);
+  SREG = sreg;
+}
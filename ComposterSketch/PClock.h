@@ -0,0 +1,30 @@
+/**
+ * PClock.h --- Scales the CPU clock down to 2 MHz whenever nobody needs the full 16 MHz
+ *
+ * Like PPower, PClock counts holds:  subsystems that need full speed (tone() pitch, USB servicing)
+ * acquire it and release it when done.  With no holds, the CPU runs at 2 MHz and the prescalers of
+ * timer0, timer1, the ADC and the TWI are rescaled so that millis(), PTimer, delay(), the motor's PWM
+ * frequency, ADC conversions and the I2C bit rate are unaffected.
+ */
+
+#ifndef PCLOCK_H_
+#define PCLOCK_H_
+
+#include "Arduino.h"
+#include "PPower.h"
+
+class PClock {
+public:
+  static void begin();                      //Drop to the slow clock unless somebody holds the fast one
+  static void acquire();                    //Hold the full 16 MHz clock
+  static void release();                    //Drop a hold.  The CPU slows down after the last one.
+  static bool isFast();                     //Is the CPU running at 16 MHz?
+  static void tune(PPeripheral);            //Rescale a peripheral that has just been powered-up
+
+private:
+  static void setSpeed(bool);
+  static byte holds;                        //Number of subsystems that need full speed
+  static bool fast;                         //Current CPU speed
+};
+
+#endif /* PCLOCK_H_ */
@@ -0,0 +1,118 @@
+/******************************************************************************************************************
+ * PPower.cpp --- Reference-counted power management of the processor's on-chip peripherals
+ *
+ * Each peripheral has a count of the subsystems holding it.  The first acquire() powers the peripheral
+ * up and the last release() powers it down again using the power reduction register (avr/power.h).
+ *
+ * Notes:  The ADC must be disabled (ADEN cleared) before its clock is stopped, and re-enabled after.
+ * The first conversion after re-enabling takes 25 rather than 13 ADC clocks (about 200 us).
+ * Other peripherals resume in the state they were in when their clock was stopped, except that PClock
+ * re-tunes their prescalers in case the CPU clock changed meanwhile.
+ * The USB controller is not stopped through the power reduction register.  Instead it detaches from the
+ * bus, freezes its clock and stops its 48 MHz PLL, but stays enabled (USBE) with its VBUS pad (OTGPADE)
+ * alive so PUsb can tell when a host is plugged in.  The core's detach() only drops off the bus, so the
+ * clock and PLL are stopped here.  Powering up follows the datasheet:  start the PLL, wait for it to lock,
+ * unfreeze the clock, then attach and enumerate.
+ *
+ * Holders:  Battery (ADC), Schedule (TWI for the rtc), SoundMaker (timer3 for tone()),
+ * MotorController (timer1 for PWM while the controller is powered), PUsb (USB while a cable is plugged in).
+ * Nobody holds USART1 or SPI, so begin() powers them down for good.
+ *
+ ******************************************************************************************************************/
+
+#include "Arduino.h"
+#include <avr/power.h>
+#include "Composter.h"
+#include "PDebug.h"
+#include "PPower.h"
+#include "PClock.h"
+
+byte PPower::holds[PWRCOUNT];
+bool PPower::begun = false;
+
+
+/**
+ * Power-down every peripheral that no subsystem has acquired.  Following a reset everything is powered,
+ * so until begin() is called the hold counts only record who is using what.
+ */
+void PPower::begin() {
+  begun = true;
+  for (byte p = 0; p < PWRCOUNT; p++) {
+    if (holds[p] == 0) disable((PPeripheral) p);
+  }
+}
+
+
+/**
+ * Hold a peripheral, powering it up if nobody else already holds it
+ */
+void PPower::acquire(PPeripheral p) {
+  if (holds[p]++ == 0 && begun) enable(p);
+}
+
+
+/**
+ * Drop a hold on a peripheral, powering it down if this was the last one
+ */
+void PPower::release(PPeripheral p) {
+  if (holds[p] == 0) return;                //Unbalanced release.  Ignore it.
+  if (--holds[p] == 0 && begun) disable(p);
+}
+
+
+/**
+ * Is the peripheral powered?
+ */
+bool PPower::isPowered(PPeripheral p) {
+  return !begun || holds[p] > 0;
+}
+
+
+//Private method to power-up a peripheral
+void PPower::enable(PPeripheral p) {
+  switch (p) {
+    case PWRADC:
+      power_adc_enable();
+      ADCSRA |= (1 << ADEN);                //Re-enable the converter
+      break;
+    case PWRTWI:    power_twi_enable();     break;
+    case PWRUSART1: power_usart1_enable();  break;
+    case PWRSPI:    power_spi_enable();     break;
+    case PWRTIMER1: power_timer1_enable();  break;
+    case PWRTIMER3: power_timer3_enable();  break;
+    case PWRUSB:
+      PLLCSR |= (1 << PLLE);                //Restart the PLL...
+      while (!(PLLCSR & (1 << PLOCK)));     //...and let it lock
+      USBCON &= ~(1 << FRZCLK);             //Unfreeze the controller's clock
+      USBDevice.attach();                   //Attach and re-enumerate
+      break;
+    default:
+      break;
+  }
+  PClock::tune(p);
+}
+
+
+//Private method to power-down a peripheral
+void PPower::disable(PPeripheral p) {
+  switch (p) {
+    case PWRADC:
+      ADCSRA &= ~(1 << ADEN);               //Must disable the converter before stopping its clock
+      power_adc_disable();
+      break;
+    case PWRTWI:    power_twi_disable();    break;
+    case PWRUSART1: power_usart1_disable(); break;
+    case PWRSPI:    power_spi_disable();    break;
+    case PWRTIMER1: power_timer1_disable(); break;
+    case PWRTIMER3: power_timer3_disable(); break;
+    case PWRUSB:
+      USBDevice.detach();                   //Drop off the bus
+      UDCON |= (1 << DETACH);               //(Older cores' detach() does nothing)
+      USBCON |= (1 << FRZCLK);              //Freeze the controller's clock...
+      PLLCSR &= ~(1 << PLLE);               //...and stop the PLL
+      USBCON |= (1 << USBE) | (1 << OTGPADE);  //...but stay enabled, sensing VBUS
+      break;
+    default:
+      break;
+  }
+}
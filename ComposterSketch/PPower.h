@@ -0,0 +1,39 @@
+/**
+ * PPower.h --- Reference-counted manager for the 32U4's on-chip peripherals
+ *
+ * A subsystem acquires the peripherals it is about to use and releases them when it is done.
+ * A peripheral stays powered only while at least one subsystem holds it, so no subsystem needs
+ * to know what the others are doing.
+ */
+
+#ifndef PPOWER_H_
+#define PPOWER_H_
+
+#include "Arduino.h"
+
+  enum PPeripheral {
+    PWRADC,       //Analog-to-digital converter (battery voltage)
+    PWRTWI,       //I2C bus (real-time clock)
+    PWRUSART1,    //Hardware serial port (its pins are wired to buttons B1 and B2)
+    PWRSPI,       //SPI bus (reserved for an LCD panel)
+    PWRTIMER1,    //Timer1 (motor PWM on pin 9)
+    PWRTIMER3,    //Timer3 (tone() for the speaker)
+    PWRUSB,       //USB controller (serial logging to a host)
+    PWRCOUNT      //Number of managed peripherals
+  };
+
+class PPower {
+public:
+  static void begin();                      //Power-down every peripheral nobody holds
+  static void acquire(PPeripheral);         //Power-up the peripheral (if needed) and hold it
+  static void release(PPeripheral);         //Drop a hold, powering-down the peripheral after the last one
+  static bool isPowered(PPeripheral);       //Is the peripheral currently powered?
+
+private:
+  static void enable(PPeripheral);
+  static void disable(PPeripheral);
+  static byte holds[PWRCOUNT];              //Number of subsystems holding each peripheral
+  static bool begun;                        //begin() has powered-down the unused peripherals
+};
+
+#endif /* PPOWER_H_ */
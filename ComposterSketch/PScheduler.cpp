@@ -0,0 +1,79 @@
+/******************************************************************************************************************
+ * PScheduler.cpp --- Cooperative periodic task scheduler
+ *
+ * Each task is run from loop() when its due time arrives and its next due time advances by its period.  Times
+ * are compared as a signed difference so they survive the wrap of millis().  Run times are measured with
+ * micros(), which costs a few microseconds per task at 2 MHz.
+ *
+ ******************************************************************************************************************/
+
+#include "Arduino.h"
+#include "Composter.h"
+#include "PDebug.h"
+#include "PScheduler.h"
+
+
+//Has time t arrived?  Correct across the wrap of millis() for times less than 24 days apart.
+static bool hasArrived(unsigned long t) {
+  return (long) (millis() - t) >= 0;
+}
+
+
+/**
+ * Constructor
+ * table - the tasks (their dueMs and overruns are maintained here)
+ * n - number of tasks in table
+ */
+PScheduler::PScheduler(PTask *table, byte n) {
+  tasks = table;
+  nTasks = n;
+  for (byte i = 0; i < nTasks; i++) tasks[i].dueMs = 0;   //Due as soon as millis() starts
+}
+
+
+/**
+ * Run every task that is due, in table order
+ */
+void PScheduler::runDue() {
+  for (byte i = 0; i < nTasks; i++) {
+    PTask &t = tasks[i];
+    if (!hasArrived(t.dueMs)) continue;
+    unsigned long t0 = micros();
+    t.run();
+    unsigned long us = micros() - t0;
+    if (us > t.budgetUs) {
+      t.overruns++;
+      DPRINT(String("overrun ")+t.name+" "+String(us)+" us");
+    }
+    t.dueMs += t.periodMs;                        //Fixed rate...
+    if (hasArrived(t.dueMs)) t.dueMs = millis() + t.periodMs;   //...unless we've fallen a period behind
+  }
+}
+
+
+/**
+ * Is any task due?
+ */
+bool PScheduler::isDue() {
+  for (byte i = 0; i < nTasks; i++) {
+    if (hasArrived(tasks[i].dueMs)) return true;
+  }
+  return false;
+}
+
+
+/**
+ * Make every task due now
+ */
+void PScheduler::makeAllDue() {
+  unsigned long now = millis();
+  for (byte i = 0; i < nTasks; i++) tasks[i].dueMs = now;
+}
+
+
+//Total overruns of all tasks
+unsigned int PScheduler::getOverruns() {
+  unsigned int n = 0;
+  for (byte i = 0; i < nTasks; i++) n += tasks[i].overruns;
+  return n;
+}
@@ -0,0 +1,38 @@
+/**
+ * PScheduler.h --- Cooperative scheduler running periodic tasks at their own rates
+ *
+ * The sketch declares a static table of PTasks, each with a period and a budget, and calls runDue() from
+ * loop().  A task whose run takes longer than its budget is counted as an overrun.  Tasks run at a fixed
+ * rate; one that falls more than a period behind skips the missed runs rather than bursting to catch up.
+ *
+ * Note:  millis() stops while the processor naps, so the sketch calls makeAllDue() after each nap.
+ */
+
+#ifndef PSCHEDULER_H_
+#define PSCHEDULER_H_
+
+#include "Arduino.h"
+
+struct PTask {
+  const char *name;           //For overrun reports
+  void (*run)();              //What to do
+  unsigned int periodMs;      //How often to do it
+  unsigned int budgetUs;      //How long it may take
+  unsigned long dueMs;        //When it's next due (millis())
+  unsigned int overruns;      //Runs that took longer than budgetUs
+};
+
+class PScheduler {
+public:
+  PScheduler(PTask *, byte);  //Schedule a table of tasks.  All are due immediately.
+  void runDue();              //Run every task that is due
+  bool isDue();               //Is any task due?
+  void makeAllDue();          //Make every task due now
+  unsigned int getOverruns(); //Total overruns of all tasks
+
+private:
+  PTask *tasks;
+  byte nTasks;
+};
+
+#endif /* PSCHEDULER_H_ */
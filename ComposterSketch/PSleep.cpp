@@ -14,12 +14,13 @@
  #include "PDebug.h"
  #include "PTimer.h"
  #include "LowPower.h"
+ #include "PPower.h"
  #include "PSleep.h"
 
 
 
   //This is the idle timer used to measure the duration in ms of periods of inactivity
-  static PTimer it = PTimer(IAMS);
+  static PFixedTimer<IAMS> it;
 
 
 /*
@@ -75,8 +76,8 @@ PSleep::PSleep() {
   * Take a nap by configuring the processor to awaken in response to certain interrupts or WDT, place the
   * processor in some power-saving mode, and restore the operating environment following the nap.
   * 
-  * Note:  Requests to sleep are ignored if battery voltage is excessive.  The idea is to drain the 
-  * excessive charge.
+  * Note:  The processor naps even while the battery is overcharged.  The surplus is spent on extra
+  * autorun pulses instead (see Battery.cpp and Schedule.cpp), which loop() starts as it wakes.
   */
   void PSleep::sleepNow() {
     DPRINT("sleepNow()");
@@ -86,7 +87,19 @@ PSleep::PSleep() {
     //Stop the CPU and many functions while awkening after 8 seconds using the WDT or another specified interrupt
     TXLED0;                   //Snuff the TX Data LED
     RXLED0;                   //Snuff the RX Data LED
-    LowPower.idle(SLEEP_8S,ADC_OFF,TIMER4_OFF,TIMER3_OFF,TIMER1_OFF,TIMER0_OFF,SPI_OFF,USART1_OFF,TWI_OFF,USB_OFF);
+    //LowPower re-enables whatever it was told to turn off, so only name the peripherals that are powered now.
+    //Those that PPower has already powered-down are passed as "on", which LowPower leaves alone.  USB is
+    //left alone too:  when released it is already frozen, and when held a host is plugged in and powering us.
+    LowPower.idle(SLEEP_8S,
+                  PPower::isPowered(PWRADC) ? ADC_OFF : ADC_ON,
+                  TIMER4_OFF,
+                  PPower::isPowered(PWRTIMER3) ? TIMER3_OFF : TIMER3_ON,
+                  PPower::isPowered(PWRTIMER1) ? TIMER1_OFF : TIMER1_ON,
+                  TIMER0_OFF,
+                  PPower::isPowered(PWRSPI) ? SPI_OFF : SPI_ON,
+                  PPower::isPowered(PWRUSART1) ? USART1_OFF : USART1_ON,
+                  PPower::isPowered(PWRTWI) ? TWI_OFF : TWI_ON,
+                  USB_ON);
 
     //Awaken following a nap
     DWAITUSB(1);
@@ -94,3 +107,14 @@ PSleep::PSleep() {
 
   }
 
+
+
+ /**
+  * Doze until the next interrupt.  Unlike a nap, nothing is powered-down and timer0 keeps running, so its
+  * overflow wakes the processor within about a millisecond and millis(), PWM and USB carry on undisturbed.
+  * loop() dozes between scheduled tasks rather than spinning.
+  */
+  void PSleep::doze() {
+    LowPower.idle(SLEEP_FOREVER, ADC_ON, TIMER4_ON, TIMER3_ON, TIMER1_ON, TIMER0_ON,
+                  SPI_ON, USART1_ON, TWI_ON, USB_ON);
+  }
@@ -7,6 +7,7 @@ class PSleep {
 public:
   PSleep();
   void sleepNow();
+  void doze();
   bool isIdleTimerActive();
   bool isIdleTimerExpired();
   void resetIdleTimer();
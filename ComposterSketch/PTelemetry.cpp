@@ -0,0 +1,111 @@
+/******************************************************************************************************************
+ * PTelemetry.cpp --- COBS-framed, CRC-checked binary telemetry
+ *
+ * Consistent Overhead Byte Stuffing (COBS) removes every 0x00 from a frame at the cost of one byte per 254,
+ * so 0x00 can delimit frames.  An encoded frame is at most length+2 (CRC) +1 (overhead) +2 (delimiters) bytes
+ * and goes to Serial in a single write(), which keeps the USB time per frame to one packet.  The leading
+ * delimiter separates the frame from any LOG text written since the last one.
+ *
+ * Building and encoding a 16-byte payload costs well under a millisecond at 2 MHz, so the stream can stay on
+ * during real motor runs.  Frames are dropped, not queued, when no host is listening.
+ *
+ ******************************************************************************************************************/
+
+#include "Arduino.h"
+#include "Composter.h"
+#include "PDebug.h"
+#include "PTelemetry.h"
+
+
+//CRC-16/CCITT (poly 0x1021, init 0xFFFF) computed a bit at a time.  Small beats fast for a few bytes per frame.
+static unsigned int crc16(const byte *p, byte n) {
+  unsigned int crc = 0xFFFF;
+  while (n--) {
+    crc ^= (unsigned int) *p++ << 8;
+    for (byte b = 0; b < 8; b++) crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc & 0xFFFF;
+}
+
+
+/**
+ * Constructor
+ * periodMs - time between frames
+ */
+PTelemetry::PTelemetry(long periodMs) : period(periodMs) {
+  length = 0;
+  sequence = 0;
+}
+
+
+/**
+ * Is it time for the next frame?  The first call is always due.
+ */
+bool PTelemetry::isDue() {
+  if (period.isRunning()) return false;
+  period.start();
+  return true;
+}
+
+
+/**
+ * Start a frame of the specified type
+ */
+void PTelemetry::begin(byte type) {
+  length = 0;
+  put(type);
+  put(sequence++);
+}
+
+
+/**
+ * Append a byte to the frame.  Fields beyond TELEMAXPAYLOAD are dropped.
+ */
+void PTelemetry::put(byte b) {
+  if (length < TELEMAXPAYLOAD) payload[length++] = b;
+}
+
+
+//Append a 16-bit field (little-endian)
+void PTelemetry::put16(unsigned int w) {
+  put(w & 0xFF);
+  put((w >> 8) & 0xFF);
+}
+
+
+//Append a 32-bit field (little-endian)
+void PTelemetry::put32(unsigned long l) {
+  put16(l & 0xFFFF);
+  put16((l >> 16) & 0xFFFF);
+}
+
+
+/**
+ * Append the CRC, COBS-encode the frame and write it to the host
+ */
+void PTelemetry::send() {
+  unsigned int crc = crc16(payload, length);
+  byte n = length;
+  payload[n++] = crc >> 8;
+  payload[n++] = crc & 0xFF;
+
+  byte out[TELEMAXPAYLOAD + 6];
+  out[0] = 0;                             //Leading delimiter
+  byte code = 1;                          //Index of the current block's code byte
+  byte o = 2;
+  for (byte i = 0; i < n; i++) {
+    if (payload[i] == 0) {
+      out[code] = o - code;               //Zero ends the block.  Its code points at the next zero.
+      code = o++;
+    } else {
+      out[o++] = payload[i];
+      if (o - code == 0xFF) {             //Block is full (254 data bytes).  Can't happen under TELEMAXPAYLOAD.
+        out[code] = 0xFF;
+        code = o++;
+      }
+    }
+  }
+  out[code] = o - code;
+  out[o++] = 0;                           //Trailing delimiter
+  Serial.write(out, o);
+}
@@ -0,0 +1,36 @@
+/**
+ * PTelemetry.h --- Fixed-layout binary telemetry frames sent to a USB host at a steady rate
+ *
+ * A frame is built with begin(), put*() and send().  send() appends a CRC-16/CCITT (poly 0x1021, init 0xFFFF,
+ * big-endian), COBS-encodes the result and writes it between 0x00 delimiters, so a host can resynchronize
+ * on any zero byte and discard anything (e.g. LOG text) that fails the CRC.  Multi-byte fields are little-endian.
+ *
+ * Every frame starts with its type and a sequence number that wraps at 256, so a host can detect lost frames.
+ */
+
+#ifndef PTELEMETRY_H_
+#define PTELEMETRY_H_
+
+#include "Arduino.h"
+#include "PTimer.h"
+
+#define TELEMAXPAYLOAD  32                //Longest frame payload (type and sequence number included)
+
+class PTelemetry {
+public:
+  PTelemetry(long);                       //Build a stream sending a frame every so many mS
+  bool isDue();                           //Is it time for the next frame?  (Restarts the period if so)
+  void begin(byte);                       //Start a frame of the specified type
+  void put(byte);                         //Append fields to the frame...
+  void put16(unsigned int);
+  void put32(unsigned long);
+  void send();                            //...and send it
+
+private:
+  PTimer period;                          //Time until the next frame
+  byte payload[TELEMAXPAYLOAD + 2];       //Frame under construction, with room for its CRC
+  byte length;                            //Bytes in payload
+  byte sequence;                          //Sequence number of the next frame
+};
+
+#endif /* PTELEMETRY_H_ */
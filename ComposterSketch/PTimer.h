@@ -5,11 +5,20 @@
  * timer does not invoke a call-back when a timer object expires.  An application must poll the
  * status of a timer to determine its state (idle, active, expired).
  *
- * Note:  The arduino's elapsed-time clock, millis(), wraps around its unsigned long after about
- * 50 days.  We mitigate this issue with two workarounds:
+ * The timers come in a small family built from one template, so each can be as small as its job:
+ *
+ *	PTimer					32-bit, duration set at run time (up to 2,147,483 mS)
+ *	PShortTimer				16-bit, duration set at run time (up to 32,767 mS)
+ *	PFixedTimer<mS>			32-bit, duration fixed at compile time
+ *	PShortFixedTimer<mS>	16-bit, duration fixed at compile time
  *
- * 	(1) We limit the maximum duration of a PTimer to be 2,147,483 mS.
- * 	(2) We anticipate wrap-arounds with an extra state, TIMERWILLWRAP
+ * A fixed duration is a template parameter, so it costs no RAM.  A PShortFixedTimer needs just 3 bytes.
+ *
+ * Note:  The arduino's elapsed-time clock, millis(), wraps around its unsigned long after about
+ * 50 days, and a 16-bit timer sees it wrap every 65.5 seconds.  A timer compares the time with its
+ * expiration time as a signed difference, which is correct across a wrap so long as the difference
+ * stays under half the timer's range.  So a running timer must be polled within one maximum duration
+ * of expiring (32.7 seconds for a 16-bit timer).  Once seen, expiry is latched until reset() or start().
  *
  *
  *  Created on: Apr 4, 2016
@@ -19,26 +28,55 @@
 #ifndef PTIMER_H_
 #define PTIMER_H_
 
-class PTimer {
+#include "Arduino.h"
+
+template <typename T, typename S> class PTimerBase {
 public:
-	PTimer(long);						//Build a timer for the specified duration mS
-	void start();						//Start the timer for duration mS
-	bool isExpired();					//Has timer expired?
-	void reset();						//Reset the timer, stopping it if active
-	void update();						//Update timer status
-  bool isRunning();       //true if the timer is running
-  bool isActive();        //true if the timer is not idle or expired
-//  static void suspend();  //suspends all timer activity while processor sleeps
-//  static void resume();   //resumes timer activity
+	PTimerBase() : expirationTime(0), state(TIMERIDLE) {}
+	bool isExpired() { update(); return state==TIMEREXPIRED; }	//Has timer expired?
+	bool isRunning() { update(); return state==TIMERACTIVE; }	//true if the timer is running
+	bool isActive() { return state==TIMERACTIVE; }				//true if the timer is not idle or expired
+	void reset() { state = TIMERIDLE; }							//Reset the timer, stopping it if active
+	void update() {												//Update timer status
+		if (state==TIMERACTIVE && (S) (T) (now() - expirationTime) >= 0) state = TIMEREXPIRED;
+	}
+
+protected:
+	void startFor(T mS) {										//Start the timer for mS
+		expirationTime = now() + mS;
+		state = TIMERACTIVE;
+	}
+
 private:
 	enum TimerState {TIMERIDLE,			//Timer has not been started
 					TIMERACTIVE,		//Timer has been started and is still running toward expirationTime
-					TIMERWILLWRAP,		//Timer anticipates a wrap-around before running toward expirationTime
 					TIMEREXPIRED		//Timer has expired but has not been reset nor re-started
 	};
-	unsigned long expirationTime;		//Time when the running timer will expire
-	unsigned long duration;				//Elapsed duration of this timer object
-	TimerState state;
+	static T now() { return (T) millis(); }	//The low bits of millis() are all a short timer needs
+	T expirationTime;					//Time when the running timer will expire
+	byte state;							//A TimerState
 };
 
+//A timer whose duration is set at run time
+template <typename T, typename S> class PVarTimer : public PTimerBase<T, S> {
+public:
+	PVarTimer(long mS) : duration(mS) {}	//Build a timer for the specified duration mS
+	void start() { this->startFor(duration); }	//Start the timer for duration mS
+	void setDuration(long mS) { duration = mS; }	//Change the duration used by the next start()
+private:
+	T duration;							//Elapsed duration of this timer object
+};
+
+//A timer whose duration is fixed at compile time
+template <typename T, typename S, T MS> class PConstTimer : public PTimerBase<T, S> {
+	static_assert(MS <= (T) ~(T) 0 >> 1, "Timer duration exceeds half the timer's range");
+public:
+	void start() { this->startFor(MS); }	//Start the timer for MS
+};
+
+typedef PVarTimer<uint32_t, int32_t> PTimer;
+typedef PVarTimer<uint16_t, int16_t> PShortTimer;
+template <uint32_t MS> using PFixedTimer = PConstTimer<uint32_t, int32_t, MS>;
+template <uint16_t MS> using PShortFixedTimer = PConstTimer<uint16_t, int16_t, MS>;
+
 #endif /* PTIMER_H_ */
@@ -0,0 +1,109 @@
+/******************************************************************************************************************
+ * PUsb.cpp --- Background detection of a USB host
+ *
+ * Booting no longer waits for a host.  Instead, update() watches the 32U4's VBUS pad from loop().  When a
+ * cable is plugged in, serial logging acquires the USB controller (via PPower) and attaches to the bus; once
+ * the host opens the serial port, update() reports the new connection so the sketch can log its banner.
+ * When the cable is pulled, the controller is released again.
+ *
+ * The CPU runs at full speed whenever the controller is attached (see PClock.cpp).
+ *
+ * Note:  While VBUS is present the board can draw its power from the host, so we hold the controller for as
+ * long as the cable is plugged in rather than timing out an idle connection.
+ *
+ ******************************************************************************************************************/
+
+#include "Arduino.h"
+#include "Composter.h"
+#include "PDebug.h"
+#include "PPower.h"
+#include "PClock.h"
+#include "PUsb.h"
+
+
+//Is a host supplying VBUS?  The VBUS pad stays enabled while the controller is released.
+static bool vbusPresent() {
+  return USBSTA & (1 << VBUS);
+}
+
+
+/**
+ * Constructor
+ */
+PUsb::PUsb() {
+  state = USBDETACHED;
+}
+
+
+/**
+ * Start watching for a host.  The Arduino core attached the controller at reset, so we hold it
+ * only if a cable is already plugged in.
+ */
+void PUsb::begin() {
+  Serial.begin(57600);
+  state = USBDETACHED;
+  if (vbusPresent()) attach();
+}
+
+
+/**
+ * Poll the bus.  Returns true when a host has just opened the serial port.
+ */
+bool PUsb::update() {
+
+  switch(state) {
+
+    //Waiting for a cable.  Attach to the bus when VBUS appears.
+    case USBDETACHED:
+      if (vbusPresent()) attach();
+    break;
+
+    //Attached and waiting for the host to open the serial port
+    case USBWAITING:
+      if (!vbusPresent()) {
+        detach();
+      } else if (SerialUSB) {
+        state = USBCONNECTED;
+        return true;
+      }
+    break;
+
+    //Logging to the host until it closes the port or the cable is pulled
+    case USBCONNECTED:
+      if (!vbusPresent()) {
+        detach();
+      } else if (!SerialUSB) {
+        state = USBWAITING;
+      }
+    break;
+  }
+  return false;
+}
+
+
+//Private method to attach to the bus at full speed
+void PUsb::attach() {
+  PClock::acquire();
+  PPower::acquire(PWRUSB);
+  state = USBWAITING;
+}
+
+
+//Private method to drop off the bus
+void PUsb::detach() {
+  PPower::release(PWRUSB);
+  PClock::release();
+  state = USBDETACHED;
+}
+
+
+//Is a host listening?
+bool PUsb::isConnected() {
+  return state==USBCONNECTED;
+}
+
+
+//Get the state
+PUsbState PUsb::getState() {
+  return state;
+}
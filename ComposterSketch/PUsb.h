@@ -0,0 +1,28 @@
+/**
+ * PUsb.h --- Detects a USB host in the background and attaches serial logging when one appears
+ */
+
+#ifndef PUSB_H_
+#define PUSB_H_
+
+  enum PUsbState {
+    USBDETACHED,    //No host.  The USB controller is powered-down except for its VBUS pad.
+    USBWAITING,     //VBUS present.  Attached to the bus and waiting for the host to open the port.
+    USBCONNECTED    //A host has opened the serial port.  Logging flows to it.
+  };
+
+class PUsb {
+public:
+  PUsb();
+  void begin();               //Start watching for a host (does not wait for one)
+  bool update();              //Poll the bus.  Returns true when a host has just connected.
+  bool isConnected();         //Is a host listening to the serial port?
+  PUsbState getState();
+
+private:
+  void attach();
+  void detach();
+  PUsbState state;
+};
+
+#endif /* PUSB_H_ */
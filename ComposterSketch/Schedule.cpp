@@ -4,6 +4,30 @@
  * Note:  The implementation assumes that it owns the SparkFun DS1307 Real-Time Clock (RTC).
  * Note:  Only enabled, not finished, is kept in EEPROM to avoid wearing out EEPROM write cycles
  * as the machine toggles every day to finished and not.
+ *
+ * Solar-aware autorun (SOLARAUTORUN):  A B3 tap at 6 AM would otherwise run the drum every morning
+ * with the battery at its lowest after a night of standby.  Each time the schedule is updated, the battery
+ * voltage is fed into a ChargeProfile.  At the start of each day the autorun is planned for the end
+ * of the hour at which the battery has usually been fullest, while the panel is still producing, but
+ * no more than SOLARSLEWH hours from the tapped time.  The tapped time stands until the learned
+ * curve over that window has a clear peak.
+ *
+ * Clock drift:  The DS1307's crystal drifts with the garden's temperature.  SetComposterTime measures
+ * the drift between syncs with a host and leaves it in EEPROM as ppm along with the time of the last
+ * sync.  readClock() takes the accumulated drift off every reading, so the schedule runs on corrected
+ * time (seconds since 2000) rather than on the RTC's raw fields.
+ *
+ * Timekeeping:  An I2C transfer with the RTC wakes the TWI and costs about a millisecond, and update() runs after
+ * every nap, so the RTC is only read every CLOCKREADS seconds.  In between, the time is carried forward by millis()
+ * and by NAPMS for each nap the watchdog ended (BUTTONNAPMS for a nap a button cut short).  The watchdog's
+ * oscillator is only good to a few percent, so the hourly read puts the time right.  If the naps ran fast
+ * past midnight, the read must not take the time back into yesterday, which would start the day twice.
+ * The time holds at midnight instead, and only a later day starts a new one.
+ *
+ * Surplus pulses:  While the battery is overcharged, the schedule calls for an extra pulse of the drum every
+ * OCGAPS seconds, so the panel's surplus aerates the compost rather than boiling the battery.  Pulses stop once
+ * they have added OCDAYMS of motor time to the day, and only run while the daily autorun is enabled, since
+ * disabling it is how a user keeps the drum still.
  * 
  ****************************************************************************************************************/
  
@@ -14,8 +38,22 @@
 #include "Composter.h"
 #include "PTimer.h"
 #include "PDebug.h"
+#include "PPower.h"
+#include "Battery.h"
+#include "Stats.h"
 #include "Schedule.h"
 
+#define MAXPPM  500L                      //Larger corrections are taken to be erased EEPROM
+
+
+//Days from 1/1/2000 to a date in 2000..2099
+static long daysSince2000(byte y, byte m, byte d) {
+  static const int before[] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+  long days = 365L * y + (y + 3) / 4 + before[m - 1] + d - 1;   //(y+3)/4 leap years precede year y
+  if (m > 2 && y % 4 == 0) days++;                              //Past February of a leap year
+  return days;
+}
+
 
 /**
  * Constructor does nothing for now
@@ -32,28 +70,53 @@
 void Schedule::start() { 
   
   //Boot-up time initialization of the RTC 
+  PPower::acquire(PWRTWI);        //The I2C bus is only powered while we talk to the RTC
   rtc.begin();                    //Setup I2C communication with RTC
   rtc.writeSQW(SQW_LOW);          //Disable the battery-sucking SQW feature
   rtc.set24Hour(true);            //Configure RTC for 24-hour service
-  today = rtc.getDay();           //Remember which day we started
+  PPower::release(PWRTWI);
+
+  //Pick up the RTC's calibration from SetComposterTime
+  EEPROM.get(EERTCSYNC,syncS);
+  EEPROM.get(EERTCPPM,ppm);
+  if (syncS <= 0L || ppm < -MAXPPM || ppm > MAXPPM) {
+    syncS = 0L;                   //Never synced (or erased):  trust the RTC
+    ppm = 0L;
+  }
+  napMs = 0L;
+  readClock();                    //Read the current time
+  today = nowS / 86400L;          //Remember which day we started
 
   //Booting up resets the scheduler's state
   composterRanToday=false;
+  surplusS = 0L;
+  surplusMs = 0L;
+  profile.load();                 //...but not what we've learned about the battery
+  plan();
   
 }
 
 
 /**
- * Update scheduler/rtc status 
+ * Update scheduler/rtc status.  The sketch's scheduler calls this once a minute and after each nap.
  */
  void Schedule::update() {
   
   //If the day has changed then we haven't ran today
-  rtc.update();                     //Update the clock
-  byte thisDay = rtc.getDay();      //Get the day of the month from RTC
-  if (thisDay != today) {           //Has it changed since we last checked?
+  tick();                           //Update the clock...
+  if (nowS - readS >= CLOCKREADS) { //...reading the RTC hourly
+    readClock();
+    if (nowS < today * 86400L) nowS = today * 86400L;  //Naps ran fast past midnight.  Wait for the RTC.
+  }
+  profile.sample(getHour(), Battery::getSampled());   //Learn the battery's daily curve
+  long thisDay = nowS / 86400L;     //Get the day from the corrected clock
+  if (thisDay > today) {            //Has it changed since we last checked?
+    if (enabled() && !composterRanToday) Stats::count(STMISSED);
+    Stats::newDay();
     composterRanToday = false;      //Yes, then the composter hasn't ran today
+    surplusMs = 0L;                 //...nor spent any surplus
     today = thisDay;                //Remember new day
+    plan();                         //Pick today's autorun time
   }
   
  }
@@ -70,8 +133,11 @@ void Schedule::start() {
 
   DPRINT("setStartTime()");
 
+  //The clock is only read hourly (see update()), so read it now
+  readClock();
+
   //Calculate the current time as seconds elapsed since last midnight 
-  long currentSecond = rtc.getHour() * 3600L + rtc.getMinute()*60L + rtc.getSecond();
+  long currentSecond = nowS % 86400L;
 
   //Don't configure the starting time in the last minute of the day because it will wrap around at midnight
   startingSecond = (currentSecond < 86340L) ? currentSecond : 0L;   //If it's close to midnight then use midnight for startingSecond
@@ -80,10 +146,33 @@ void Schedule::start() {
   bool enabled=true;
   EEPROM.put(EESKEDSTART,startingSecond);
   EEPROM.put(EESKEDEN,enabled);
+  plan();
       
   }
 
 
+/**
+ * Private method to choose today's autorun time from the tapped time and, if SOLARAUTORUN, the battery's
+ * learned daily curve.
+ */
+ void Schedule::plan() {
+  EEPROM.get(EESKEDSTART,startSecond);      //Second past midnight when B3 was tapped
+#if SOLARAUTORUN==1
+  long earliest = startSecond - SOLARSLEWH * 3600L;
+  long latest = startSecond + SOLARSLEWH * 3600L;
+  if (earliest < 0L) earliest = 0L;         //Stay within today
+  if (latest > 86339L) latest = 86339L;
+  byte peak = profile.peakHour(earliest / 3600L, latest / 3600L);
+  if (peak != NOPEAK) {
+    startSecond = (peak + 1) * 3600L;       //Just after the battery's usual peak
+    if (startSecond < earliest) startSecond = earliest;
+    if (startSecond > latest) startSecond = latest;
+  }
+#endif
+  DPRINT("plan() autorun at "+String(startSecond));
+ }
+
+
   /**
    * Is it time to start the composter running?
    * 
@@ -91,22 +180,20 @@ void Schedule::start() {
  bool Schedule::isTimeToStart() {
 
     bool enabled=false;
-    long startingSecond;
     
-    //Look-up state variables from non-volatile (EEPROM) memory
-    EEPROM.get(EESKEDSTART,startingSecond); //Second past midnight when autorun starts if scheduler is enabled
+    //Look-up state variable from non-volatile (EEPROM) memory.  Today's start time was planned from it at midnight.
     EEPROM.get(EESKEDEN,enabled);           //true if scheduler is enabled, false otherwise
     
     //We'll only consider starting the composter if the scheduler is actually enabled
     if (enabled) {
 
       //Calculate the current time as seconds elapsed since last midnight
-      long currentSecond = rtc.getHour() * 3600L + rtc.getMinute()*60L + rtc.getSecond();
+      long currentSecond = nowS % 86400L;
 
-      DPRINT("isTimeToStart composterRanToday="+String(composterRanToday)+" Currently "+String(currentSecond)+", Scheduled "+String(startingSecond));
+      DPRINT("isTimeToStart composterRanToday="+String(composterRanToday)+" Currently "+String(currentSecond)+", Scheduled "+String(startSecond));
       
       //If the composter hasn't already ran then check to see if it's time to run
-      return composterRanToday ? false : currentSecond>=startingSecond;
+      return composterRanToday ? false : currentSecond>=startSecond;
       
     } else {
       return false;                             //Composter's autoRun schedule isn't enabled
@@ -115,6 +202,34 @@ void Schedule::start() {
 
 
 
+/**
+ * Is it time for an extra pulse to put an overcharged battery's surplus to work?
+ */
+ bool Schedule::isTimeForSurplus() {
+  if (!Battery::isHigh() || !enabled()) return false;
+  if (surplusMs + ARMS / AUTOPULSES > OCDAYMS) return false;   //Today's surplus motor time is spent
+  return surplusS == 0L || nowS - surplusS >= OCGAPS;
+ }
+
+
+/**
+ * An extra pulse has started
+ */
+ void Schedule::setSurplusRun() {
+  surplusS = nowS;
+  surplusMs += ARMS / AUTOPULSES;
+ }
+
+
+/**
+ * The processor has napped, during which millis() stood still
+ * full - true if the watchdog ended the nap, false if a button cut it short
+ */
+ void Schedule::napped(bool full) {
+  napMs += full ? NAPMS : BUTTONNAPMS;
+ }
+
+
 /**
  * Finished running today
  */
@@ -146,15 +261,49 @@ void Schedule::start() {
     * Get hour
     */
     byte Schedule::getHour() {
-      return rtc.getHour();
+      return nowS % 86400L / 3600L;
     }
 
     /**
      * Get minute
      */
      byte Schedule::getMinute() {
-      return rtc.getMinute();
+      return nowS % 3600L / 60L;
      }
 
      
 
+
+    /**
+     * Get today's autorun time (seconds past midnight)
+     */
+     long Schedule::getStartSecond() {
+      return startSecond;
+     }
+
+
+/**
+ * Private method to read the RTC and correct it for the drift accumulated since the last sync.  The
+ * correction is worked in hundreds of seconds so a year of elapsed time times MAXPPM fits in a long.
+ */
+ void Schedule::readClock() {
+  PPower::acquire(PWRTWI);
+  rtc.update();
+  PPower::release(PWRTWI);
+  nowS = daysSince2000(rtc.getYear(), rtc.getMonth(), rtc.getDate()) * 86400L +
+         rtc.getHour() * 3600L + rtc.getMinute() * 60L + rtc.getSecond();
+  if (syncS > 0L) nowS -= (nowS - syncS) / 100L * ppm / 10000L;
+  readS = nowS;
+  tickMs = millis();
+  napMs = 0L;
+ }
+
+
+//Private method to carry nowS forward by the time awake and napping since it was last brought up to date
+ void Schedule::tick() {
+  unsigned long now = millis();
+  unsigned long ms = now - tickMs + napMs;
+  nowS += ms / 1000L;
+  tickMs = now - ms % 1000L;        //Keep the fraction of a second for next time
+  napMs = 0L;
+ }
@@ -10,6 +10,8 @@
 #ifndef SCHEDULE_H_
 #define SCHEDULE_H_
 
+#include "ChargeProfile.h"
+
 class Schedule {
 public:
   Schedule();                 //Constructor
@@ -22,10 +24,27 @@ public:
   bool enabled();             //Scheduler enabled?
   byte getHour();             //Current time of day
   byte getMinute();           //Current time of day
+  long getStartSecond();      //Today's autorun time (seconds past midnight)
+  bool isTimeForSurplus();    //Is it time for an extra pulse on an overcharged battery's surplus?
+  void setSurplusRun();       //An extra pulse has started
+  void napped(bool);          //The processor has napped (true if the watchdog woke it)
   
 private:
+  void plan();                //Choose today's autorun time
+  void readClock();           //Read the RTC into nowS
+  void tick();                //Advance nowS by the time since it was last read or advanced
   bool composterRanToday;     //Composter has already ran today
-  byte  today;                //Day in this month
+  long today;                 //Day (since 1/1/2000) we're running in
+  long nowS;                  //Corrected time of the last readClock() or tick() (seconds since 2000)
+  long readS;                 //nowS at the last readClock()
+  unsigned long tickMs;       //millis() at which nowS was last brought up to date
+  long napMs;                 //Time napped since then
+  long syncS;                 //Time of the RTC's last sync with a host (seconds since 2000, 0 if none)
+  long ppm;                   //RTC drift measured at that sync (+ when the RTC runs fast)
+  long startSecond;           //Today's autorun time (seconds past midnight)
+  long surplusS;              //Time of the last surplus pulse (seconds since 2000, 0 if none)
+  long surplusMs;             //Motor time spent on surplus pulses today
+  ChargeProfile profile;      //Learned daily battery voltage curve
 };
 
 #endif /* SCHEDULE_H_ */
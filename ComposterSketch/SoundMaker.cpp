@@ -5,6 +5,8 @@
  #include "Arduino.h"
  #include "SoundMaker.h"
  #include "Composter.h"
+ #include "PPower.h"
+ #include "PClock.h"
 
 
  /**
@@ -19,8 +21,13 @@
   * Generate a click... something emulating the sound of a mechanical button being pressed
   */
 void  SoundMaker::doClick() {
+    PClock::acquire();                //tone() computes its pitch from the 16 MHz clock
+    PPower::acquire(PWRTIMER3);       //...and uses timer3 on the 32U4
     tone(pin,FREQC,1);
     delay(1);
+    noTone(pin);
+    PPower::release(PWRTIMER3);
+    PClock::release();
   }
 
 
@@ -28,8 +35,13 @@ void  SoundMaker::doClick() {
   * Generate a beep
   */
   void SoundMaker::doBeep() {
+    PClock::acquire();
+    PPower::acquire(PWRTIMER3);
     tone(pin,FREQEF,500L);
     delay(500);
+    noTone(pin);
+    PPower::release(PWRTIMER3);
+    PClock::release();
   }
 
 
@@ -37,6 +49,11 @@ void  SoundMaker::doClick() {
   * Generate a beep at frequency f
   */
   void SoundMaker::doBeep(int f) {
+    PClock::acquire();
+    PPower::acquire(PWRTIMER3);
     tone(pin,f,500L);
     delay(500);
+    noTone(pin);
+    PPower::release(PWRTIMER3);
+    PClock::release();
   }
@@ -0,0 +1,118 @@
+/******************************************************************************************************************
+ * StandbyPolicy.cpp --- Adaptive hold time for the motor controller's power relay
+ *
+ * This is the ski-rental problem:  holding the controller is renting, cycling the relay is buying.  With no
+ * history we hold for the initial time, which with the default constants is about the break-even hold (the
+ * relay cycle cost, see MCCYCLEMS in Composter.h) and so about twice the best choice in hindsight at worst.
+ * From then on, each candidate hold h is charged over the remembered gaps g:
+ *
+ *    g <= h    g            (held through the gap:  a hit)
+ *    g >  h    h + cycle    (held in vain, then the relay cycled)
+ *
+ * and the cheapest candidate wins.  Only 0 and the remembered gaps need trying, since the cost only changes
+ * at a gap.  Short runs and long runs keep separate histories:  jogging with B1/B2 earns a hold long enough
+ * to span the pauses between presses, while autoruns a day apart (recorded as longer than any hold) drive the
+ * hold after a long run to zero without spoiling the next jogging session.
+ *
+ * Note:  millis() stops while napping, but a nap only follows IAMS of awake idleness, so any gap that spans
+ * one is still recorded as longer than maxHoldMs (which must stay below IAMS).
+ *
+ ******************************************************************************************************************/
+
+#include "Arduino.h"
+#include "Composter.h"
+#include "PDebug.h"
+#include "StandbyPolicy.h"
+
+#define HOLDSLACK(g)  ((g) / 8)           //Extra hold beyond a remembered gap, since gaps vary
+
+
+/**
+ * Constructor
+ * initialMs - hold time until some gaps have been seen
+ * cycleCostMs - cost of a relay cycle, expressed as mS of holding the controller powered
+ * maxMs - longest hold time
+ * shortMs - longest run that counts as a short (jogging) run
+ */
+StandbyPolicy::StandbyPolicy(long initialMs, long cycleCostMs, long maxMs, long shortMs) {
+  cycleMs = cycleCostMs;
+  maxHoldMs = maxMs;
+  shortRunMs = shortMs;
+  idle = false;
+  idleSince = 0;
+  kind = 0;
+  for (byte k = 0; k < STANDBYKINDS; k++) {
+    holdMs[k] = initialMs;
+    nGaps[k] = 0;
+    nextGap[k] = 0;
+  }
+  hits = 0;
+  misses = 0;
+}
+
+
+//How long to hold the controller powered after the last stop
+long StandbyPolicy::getHoldMs() {
+  return holdMs[kind];
+}
+
+
+/**
+ * The motor has come to rest.  Start measuring the gap until the next start.
+ * runMs - how long the motor ran
+ */
+void StandbyPolicy::stopped(unsigned long runMs) {
+  idle = true;
+  idleSince = millis();
+  kind = runMs <= shortRunMs ? 0 : 1;
+}
+
+
+/**
+ * The motor is being started.  Record the gap since it stopped and choose the next hold time for that kind of run.
+ * held - true if the controller was still powered (no relay cycle needed)
+ */
+void StandbyPolicy::started(bool held) {
+  if (!idle) return;                      //First start since reset.  No gap to learn from.
+  idle = false;
+  unsigned long gap = millis() - idleSince;
+  if (gap > (unsigned long) maxHoldMs) gap = maxHoldMs + 1;
+  if (held) hits++;
+  else if ((long) gap < cycleMs) misses++;  //Holding through the gap would have cost less
+  gaps[kind][nextGap[kind]] = gap;
+  nextGap[kind] = (nextGap[kind] + 1) % STANDBYHISTORY;
+  if (nGaps[kind] < STANDBYHISTORY) nGaps[kind]++;
+  choose(kind);
+  DPRINT(String("gap=")+String((long) gap)+String(" hold=")+String(holdMs[kind]));
+}
+
+
+//Restarts that found the controller still powered
+unsigned int StandbyPolicy::getHits() {
+  return hits;
+}
+
+
+//Restarts that cycled the relay after a gap cheaper to have held through (shorter than a relay cycle's cost)
+unsigned int StandbyPolicy::getMisses() {
+  return misses;
+}
+
+
+//Private method to choose the hold that would have cost least over the remembered gaps of a kind of run
+void StandbyPolicy::choose(byte k) {
+  long bestHold = 0;
+  long bestCost = -1;
+  for (byte c = 0; c <= nGaps[k]; c++) {
+    long h = c < nGaps[k] ? gaps[k][c] : 0;   //Candidates:  each gap, then zero
+    if (h > maxHoldMs) continue;
+    long cost = 0;
+    for (byte i = 0; i < nGaps[k]; i++) cost += gaps[k][i] <= h ? gaps[k][i] : h + cycleMs;
+    if (bestCost < 0 || cost < bestCost || (cost == bestCost && h < bestHold)) {
+      bestCost = cost;
+      bestHold = h;
+    }
+  }
+  holdMs[k] = bestHold + HOLDSLACK(bestHold);
+  if (holdMs[k] > maxHoldMs) holdMs[k] = maxHoldMs;
+}
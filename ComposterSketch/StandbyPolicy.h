@@ -0,0 +1,44 @@
+/**
+ * StandbyPolicy.h --- Learns how long the motor controller should stay powered after the motor stops
+ *
+ * Keeping the RB-Cyt-133 powered costs the relay coil and controller standby current for as long as it is held.
+ * Dropping it to standby costs a relay cycle (inrush, contact wear and the MOTORAWAKENING delay) if the motor
+ * is restarted soon after.  The policy remembers the last few idle gaps between a stop and the next start and
+ * picks the hold time that would have cost least over them (see StandbyPolicy.cpp).  Short runs (jogging with
+ * B1/B2) and long runs (autoruns) keep separate histories, since they are followed by very different gaps.
+ */
+
+#ifndef STANDBYPOLICY_H_
+#define STANDBYPOLICY_H_
+
+#include "Arduino.h"
+
+#define STANDBYHISTORY  8                 //Number of idle gaps remembered for each kind of run
+#define STANDBYKINDS    2                 //Short runs and long runs
+
+class StandbyPolicy {
+public:
+  StandbyPolicy(long, long, long, long);  //Initial hold, relay cycle cost, longest hold and longest short run (mS)
+  long getHoldMs();                       //How long to hold the controller powered after the last stop
+  void stopped(unsigned long);            //The motor has come to rest after running so many mS
+  void started(bool);                     //The motor is starting.  true if the controller was still held.
+  unsigned int getHits();                 //Restarts that found the controller still powered
+  unsigned int getMisses();               //Restarts that cycled the relay after a gap cheaper to have held through
+
+private:
+  void choose(byte);                      //Pick the hold time for a kind of run from its history
+  long cycleMs;                           //Cost of a relay cycle, as mS of holding the controller powered
+  long maxHoldMs;                         //Longest hold we'll consider
+  unsigned long shortRunMs;               //Longest run that counts as short
+  unsigned long idleSince;                //millis() when the motor came to rest
+  bool idle;                              //A gap is being measured
+  byte kind;                              //Kind of the last run (0 short, 1 long)
+  long holdMs[STANDBYKINDS];              //Current hold time after each kind of run
+  long gaps[STANDBYKINDS][STANDBYHISTORY];  //Recent idle gaps (mS), capped at maxHoldMs+1
+  byte nGaps[STANDBYKINDS];               //Number of gaps recorded (up to STANDBYHISTORY)
+  byte nextGap[STANDBYKINDS];             //Where the next gap goes
+  unsigned int hits;
+  unsigned int misses;
+};
+
+#endif /* STANDBYPOLICY_H_ */
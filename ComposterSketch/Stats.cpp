@@ -0,0 +1,139 @@
+/******************************************************************************************************************
+ * Stats.cpp --- Operational statistics kept by the composter across resets
+ *
+ * The counters and histogram buckets are 32 bits wide so that even the WDT wake count (about 10,000 a day) won't
+ * overflow in the composter's lifetime.  They live in RAM and are written to EEPROM by the first save() after
+ * each day ends.  The sketch calls save() just before napping, where the few mS of EEPROM writes don't delay
+ * anything, and EEPROM.put() only rewrites the cells that changed, so no cell is written more than once a day.
+ * A reset loses at most a day's counts.
+ *
+ * Note:  millis() stops while napping, so a spell of naps is measured by counting them.  A button ends a nap
+ * part way through, so it is counted as half a nap.
+ *
+ ******************************************************************************************************************/
+
+#include <EEPROM.h>
+
+#include "Arduino.h"
+#include "Composter.h"
+#include "PDebug.h"
+#include "Stats.h"
+
+#define STATSVERSION  2                   //Bump when Data changes so old EEPROM contents are discarded
+
+//Upper bounds of each histogram's buckets but the last
+static const long bounds[SHHISTOGRAMS][STATBUCKETS-1] = {
+  {60L, 600L, 3600L, 14400L, 43200L},     //Spell of naps (S):  1m, 10m, 1h, 4h, 12h
+  {10L, 100L, 1000L, 10000L, IAMS},       //Awake (mS).  Above IAMS, something kept us awake.
+  {2000L, 5000L, 15000L, 30000L, 60000L}, //Motor run (mS)
+  {115, 120, 125, 130, 135}               //Battery voltage x10
+};
+
+static const char *counterNames[STCOUNTERS] = {"wake wdt", "wake button", "start b1", "start b2", "start b3",
+                                               "start sked", "refused", "missed days", "start surplus"};
+static const char *histogramNames[SHHISTOGRAMS] = {"sleep S", "awake mS", "run mS", "vstart x10"};
+
+Stats::Data Stats::data;
+bool Stats::dirty = false;
+unsigned long Stats::awakeSince = 0;
+long Stats::napSpellS = 0;
+
+
+/**
+ * Restore the statistics from EEPROM, or start afresh if EEPROM holds another layout (or nothing)
+ */
+void Stats::load() {
+  EEPROM.get(EESTATS, data);
+  if (data.version != STATSVERSION) {
+    memset(&data, 0, sizeof(data));
+    data.version = STATSVERSION;
+  }
+}
+
+
+/**
+ * Write the statistics to EEPROM if a day has passed since they were last written
+ */
+void Stats::save() {
+  if (!dirty) return;
+  EEPROM.put(EESTATS, data);
+  dirty = false;
+}
+
+
+/**
+ * A day has ended.  The statistics will be saved at the next opportunity.
+ */
+void Stats::newDay() {
+  dirty = true;
+}
+
+
+/**
+ * Count an event
+ */
+void Stats::count(StatCounter c) {
+  data.counters[c]++;
+}
+
+
+//Events counted
+unsigned long Stats::get(StatCounter c) {
+  return data.counters[c];
+}
+
+
+/**
+ * Record a value in a histogram
+ */
+void Stats::record(StatHistogram h, long value) {
+  byte b = 0;
+  while (b < STATBUCKETS-1 && value >= bounds[h][b]) b++;
+  data.buckets[h][b]++;
+}
+
+
+/**
+ * The processor is about to nap.  Record how long it has been awake.
+ */
+void Stats::sleeping() {
+  record(SHAWAKE, millis() - awakeSince);
+}
+
+
+/**
+ * The processor has awakened from a nap
+ * byButton - true if a button ended the nap, false if the WDT did
+ */
+void Stats::woke(bool byButton) {
+  count(byButton ? STWAKEBUTTON : STWAKEWDT);
+  napSpellS += (byButton ? BUTTONNAPMS : NAPMS) / 1000L;   //See Composter.h
+  awakeSince = millis();
+}
+
+
+/**
+ * The processor has something to do after a spell of naps.  Record how long the spell lasted.
+ */
+void Stats::active() {
+  if (napSpellS == 0) return;
+  record(SHSLEEP, napSpellS);
+  napSpellS = 0;
+}
+
+
+/**
+ * Print the statistics to the USB host (if one is listening)
+ */
+void Stats::print() {
+  for (byte c = 0; c < STCOUNTERS; c++) {
+    LOG(String(counterNames[c])+"="+String(data.counters[c]));
+  }
+  for (byte h = 0; h < SHHISTOGRAMS; h++) {
+    String line = String(histogramNames[h]);
+    for (byte b = 0; b < STATBUCKETS; b++) {
+      line += (b < STATBUCKETS-1 ? String(" <")+String(bounds[h][b]) : String(" >=")+String(bounds[h][b-1]))+":"+String(data.buckets[h][b]);
+    }
+    LOG(line);
+  }
+}
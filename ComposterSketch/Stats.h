@@ -0,0 +1,63 @@
+/**
+ * Stats.h --- Operational statistics kept by the composter across resets
+ *
+ * A handful of counters and small fixed-bucket histograms that show where the energy goes:  why and how long the
+ * processor sleeps, how long it stays awake, what starts the motor and for how long, and how the battery stands up.
+ * They are kept in EEPROM, saved at most once a day, and printed to a USB host when it connects or when B1 and B2
+ * are pressed together.
+ */
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include "Arduino.h"
+
+  enum StatCounter {
+    STWAKEWDT,      //Naps ended by the WDT
+    STWAKEBUTTON,   //Naps ended by a button
+    STSTARTB1,      //Motor starts by B1 (CW jog)
+    STSTARTB2,      //Motor starts by B2 (CCW jog)
+    STSTARTB3,      //Autoruns started by tapping B3
+    STSTARTSKED,    //Autoruns started by the schedule
+    STREFUSED,      //Motor starts refused because the battery was low
+    STMISSED,       //Days that ended without their scheduled autorun
+    STSTARTSURPLUS, //Extra pulses started on an overcharged battery's surplus
+    STCOUNTERS      //Number of counters
+  };
+
+  enum StatHistogram {
+    SHSLEEP,        //Length of a spell of consecutive naps (S)
+    SHAWAKE,        //Time awake from a wake (or reset) to the next nap (mS)
+    SHRUN,          //Length of a motor run, including decel (mS)
+    SHVSTART,       //Battery voltage x10 as the motor starts
+    SHHISTOGRAMS    //Number of histograms
+  };
+
+#define STATBUCKETS   6                   //Buckets per histogram.  The last one has no upper bound.
+
+class Stats {
+public:
+  static void load();                     //Restore the statistics from EEPROM (or start afresh)
+  static void save();                     //Write the statistics to EEPROM if a day has passed since the last save
+  static void newDay();                   //A day has passed
+  static void count(StatCounter);         //Count an event
+  static unsigned long get(StatCounter);  //Events counted
+  static void record(StatHistogram, long);  //Record a value in a histogram
+  static void sleeping();                 //The processor is about to nap
+  static void woke(bool);                 //The processor has awakened from a nap.  true if a button woke it.
+  static void active();                   //The processor is busy again after a spell of naps
+  static void print();                    //Print the statistics to the USB host
+
+private:
+  struct Data {
+    byte version;                         //Layout of what follows (EEPROM that doesn't match is discarded)
+    unsigned long counters[STCOUNTERS];
+    unsigned long buckets[SHHISTOGRAMS][STATBUCKETS];
+  };
+  static Data data;
+  static bool dirty;                      //A day has passed since the last save
+  static unsigned long awakeSince;        //millis() at the last wake
+  static long napSpellS;                  //Length of the current spell of naps (S)
+};
+
+#endif /* STATS_H_ */
@@ -0,0 +1,207 @@
+/******************************************************************************************************************
+ * ComposterTelemetry --- Host-side decoder for the composter's binary telemetry stream
+ *
+ * Reads the COBS-framed, CRC-checked frames sent by a controller built with TELEMETRY set to 1 (see
+ * PTelemetry.h and doTelemetry() in ComposterSketch.ino) and writes them as CSV, or as a live display that
+ * redraws in place.  Anything that fails to decode, such as the LOG text sharing the port, is counted and
+ * skipped.  Fields appended to a frame type by newer firmware are ignored; fields missing from older
+ * firmware are left empty.
+ *
+ * Build:
+ *
+ *   g++ -O2 -o composterTelemetry ComposterTelemetry/ComposterTelemetry.cpp
+ *
+ * Usage:  composterTelemetry [--live] [DEVICE|FILE|-]
+ *
+ *   composterTelemetry /dev/ttyACM0 > run.csv       Log a run (a tty is switched to raw mode)
+ *   composterTelemetry --live /dev/ttyACM0           Watch the controller
+ *
+ * A summary of frames decoded, frames rejected and frames lost (sequence gaps) goes to stderr at the end.
+ *
+ ******************************************************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define MAXFRAME    64                  //Longest encoded frame we accept
+#define FRAMESTATUS 1                   //Frame type sent by doTelemetry()
+#define STATUSLEN   16                  //...and its shortest payload
+#define STANDBYLEN  22                  //...and the payload that adds the standby statistics
+#define OVERRUNLEN  24                  //...and the one that adds task overruns
+
+//Names of ComposterSketch.ino's comState and MotorController.h's MotorState values
+static const char *comStates[] = {"IDL", "RCW", "RCC", "DCL", "B3W", "B3R", "ARN", "NAP", "ARP"};
+static const char *motorStates[] = {"STANDBY", "AWAKENING", "STOPPED", "RUNNING", "STOPPING"};
+#define NCOMSTATES   (sizeof(comStates) / sizeof(comStates[0]))
+#define NMOTORSTATES (sizeof(motorStates) / sizeof(motorStates[0]))
+
+struct Status {
+  uint8_t sequence;
+  uint32_t millis;
+  uint8_t comState, motorState, speed;
+  uint16_t voltsX10;
+  uint8_t timers;
+  uint16_t passMs, avgPassMs;
+  bool hasStandby;
+  uint16_t holdMs, hits, misses;
+  bool hasOverruns;
+  uint16_t overruns;
+};
+
+static long decoded, rejected, lost;
+
+
+//CRC-16/CCITT (poly 0x1021, init 0xFFFF), as computed by PTelemetry
+static uint16_t crc16(const uint8_t *p, size_t n) {
+  uint16_t crc = 0xFFFF;
+  while (n--) {
+    crc ^= (uint16_t) (*p++ << 8);
+    for (int b = 0; b < 8; b++) crc = crc & 0x8000 ? (uint16_t) ((crc << 1) ^ 0x1021) : (uint16_t) (crc << 1);
+  }
+  return crc;
+}
+
+
+//Undo COBS.  Returns the decoded length, or -1 if the frame is malformed.
+static int unstuff(const uint8_t *in, int n, uint8_t *out) {
+  int o = 0;
+  for (int i = 0; i < n; ) {
+    int code = in[i++];
+    if (code == 0 || i + code - 1 > n) return -1;
+    for (int k = 1; k < code; k++) out[o++] = in[i++];
+    if (code < 0xFF && i < n) out[o++] = 0;
+  }
+  return o;
+}
+
+
+static const char *name(const char **names, size_t count, uint8_t v) {
+  return v < count ? names[v] : "?";
+}
+
+
+static void printCsv(const Status &s) {
+  static bool header = false;
+  if (!header) {
+    printf("millis,seq,state,motor,speed,volts,b3t,art,idle,autorun,pass_ms,avg_pass_ms,hold_ms,hits,misses,overruns\n");
+    header = true;
+  }
+  printf("%lu,%u,%s,%s,%u,%.1f,%d,%d,%d,%d,%u,%u", (unsigned long) s.millis, s.sequence,
+         name(comStates, NCOMSTATES, s.comState), name(motorStates, NMOTORSTATES, s.motorState), s.speed,
+         s.voltsX10 / 10.0,
+         s.timers & 1, (s.timers >> 1) & 1, (s.timers >> 2) & 1, (s.timers >> 3) & 1, s.passMs, s.avgPassMs);
+  if (s.hasStandby) printf(",%u,%u,%u", s.holdMs, s.hits, s.misses);
+  else printf(",,,");
+  if (s.hasOverruns) printf(",%u\n", s.overruns);
+  else printf(",\n");
+  fflush(stdout);
+}
+
+
+//Redraw a one-line gauge of the controller's state in place
+static void printLive(const Status &s) {
+  char speedBar[21], voltBar[21];
+  int sb = s.speed * 20 / 255;
+  int vb = s.voltsX10 < 110 ? 0 : s.voltsX10 > 150 ? 20 : (s.voltsX10 - 110) / 2;    //11.0 .. 15.0 V
+  for (int i = 0; i < 20; i++) {
+    speedBar[i] = i < sb ? '#' : '.';
+    voltBar[i] = i < vb ? '#' : '.';
+  }
+  speedBar[20] = voltBar[20] = 0;
+  printf("\r%9.1fs  %-3s  %-9s  speed [%s] %3u  battery [%s] %4.1fV  %s%s%s%s pass %3ums avg %3ums ",
+         s.millis / 1000.0, name(comStates, NCOMSTATES, s.comState), name(motorStates, NMOTORSTATES, s.motorState),
+         speedBar,
+         s.speed, voltBar, s.voltsX10 / 10.0, s.timers & 1 ? "b3t " : "", s.timers & 2 ? "art " : "",
+         s.timers & 4 ? "idle " : "", s.timers & 8 ? "auto " : "", s.passMs, s.avgPassMs);
+  fflush(stdout);
+}
+
+
+//Decode one COBS-encoded frame (delimiter removed)
+static void frame(const uint8_t *in, int n, bool live) {
+  static bool haveSequence = false;
+  static uint8_t lastSequence;
+  uint8_t f[MAXFRAME];
+  int len = unstuff(in, n, f);
+  if (len < 4 || crc16(f, len - 2) != (uint16_t) (f[len - 2] << 8 | f[len - 1])) {
+    rejected++;
+    return;
+  }
+  len -= 2;
+  if (f[0] != FRAMESTATUS || len < STATUSLEN) {
+    rejected++;                         //A frame type (or version) we don't know
+    return;
+  }
+
+  Status s;
+  s.sequence = f[1];
+  s.millis = f[2] | f[3] << 8 | f[4] << 16 | (uint32_t) f[5] << 24;
+  s.comState = f[6];
+  s.motorState = f[7];
+  s.speed = f[8];
+  s.voltsX10 = (uint16_t) (f[9] | f[10] << 8);
+  s.timers = f[11];
+  s.passMs = (uint16_t) (f[12] | f[13] << 8);
+  s.avgPassMs = (uint16_t) (f[14] | f[15] << 8);
+  s.hasStandby = len >= STANDBYLEN;
+  if (s.hasStandby) {
+    s.holdMs = (uint16_t) (f[16] | f[17] << 8);
+    s.hits = (uint16_t) (f[18] | f[19] << 8);
+    s.misses = (uint16_t) (f[20] | f[21] << 8);
+  }
+  s.hasOverruns = len >= OVERRUNLEN;
+  if (s.hasOverruns) s.overruns = (uint16_t) (f[22] | f[23] << 8);
+
+  if (haveSequence) lost += (uint8_t) (s.sequence - lastSequence - 1);
+  haveSequence = true;
+  lastSequence = s.sequence;
+  decoded++;
+  if (live) printLive(s);
+  else printCsv(s);
+}
+
+
+int main(int argc, char **argv) {
+  bool live = false;
+  const char *path = "-";
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--live")) live = true;
+    else if (argv[i][0] == '-' && argv[i][1]) {
+      fprintf(stderr, "usage: composterTelemetry [--live] [DEVICE|FILE|-]\n");
+      return 2;
+    } else path = argv[i];
+  }
+
+  FILE *in = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+  if (!in) { perror(path); return 1; }
+
+  //A serial port must pass bytes through untouched
+  struct termios tio;
+  if (isatty(fileno(in)) && tcgetattr(fileno(in), &tio) == 0) {
+    cfmakeraw(&tio);
+    tcsetattr(fileno(in), TCSANOW, &tio);
+  }
+
+  uint8_t buf[MAXFRAME];
+  int n = 0;
+  bool overflow = false;
+  int c;
+  while ((c = getc(in)) != EOF) {
+    if (c != 0) {
+      if (n < MAXFRAME) buf[n++] = (uint8_t) c;
+      else overflow = true;
+      continue;
+    }
+    if (overflow) rejected++;
+    else if (n > 0) frame(buf, n, live);
+    n = 0;
+    overflow = false;
+  }
+
+  if (live) printf("\n");
+  fprintf(stderr, "composterTelemetry:  %ld frames decoded, %ld rejected, %ld lost\n", decoded, rejected, lost);
+  return 0;
+}
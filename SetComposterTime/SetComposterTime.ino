@@ -1,24 +1,54 @@
 /**
  * This is a standalone utility for programming the composter's Real Time Clock (RTC)
  * with a specified date and time.
- * 
- * The program will ask the user (via Serial connection to host Serial Monitor) to
- * input the month, day, year, hour and minute.
+ *
+ * A host syncs the clock by sending one machine-readable line holding its local time:
+ *
+ *    TYYYY-MM-DD HH:MM:SS        e.g.  date '+T%Y-%m-%d %H:%M:%S' > /dev/ttyACM0
+ *
+ * and the utility replies with one line.  If the clock was synced at least SYNCMINDAYS days
+ * before, the drift accumulated since then is measured and stored in EEPROM as ppm, where
+ * the composter's Schedule uses it to correct its readings of the clock:
+ *
+ *    SYNC drift=<RTC minus host, S> over=<S since last sync> ppm=<drift rate>
+ *    SYNC first                  (no earlier sync to measure from)
+ *    SYNC early drift=<S>        (the last sync is too recent to measure from, so the clock is left alone)
+ *
+ * Sending M instead asks the user (via Serial connection to host Serial Monitor) to input the
+ * month, day, year, hour and minute.  A clock set by hand is too rough to measure drift from,
+ * so the next sync only starts a new measurement.
  */
 #include <Wire.h>
+#include <EEPROM.h>
 #include <SparkFunDS1307RTC.h>
 
+//These must match the EEPROM address assignments in ComposterSketch/Composter.h
+#define EERTCSYNC 1008         //Time of the last sync (seconds since 2000, 0 if none)
+#define EERTCPPM  1016         //Measured drift (ppm, + when fast)
+
+#define SYNCMINDAYS 3          //Shortest interval worth measuring (1 second in 3 days is 4 ppm)
+
+
+//Days from 1/1/2000 to a date in 2000..2099 (as in ComposterSketch/Schedule.cpp)
+static long daysSince2000(byte y, byte m, byte d) {
+  static const int before[] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+  long days = 365L * y + (y + 3) / 4 + before[m - 1] + d - 1;
+  if (m > 2 && y % 4 == 0) days++;
+  return days;
+}
+
 void setup() {
- 
-  //Boot-up time initialization of the RTC 
+
+  //Boot-up time initialization of the RTC
   rtc.begin();                    //Setup I2C communication with RTC
   rtc.writeSQW(SQW_LOW);          //Disable the battery-sucking SQW feature
   rtc.set24Hour(true);            //Configure RTC for 24-hour service
 
   //While debugging the code, we initialize the RTC NVM with the TOD each time the program starts-up
-  //rtc.autoTime();                 //Set the TOD to be the compile time. 
+  //rtc.autoTime();                 //Set the TOD to be the compile time.
   Serial.begin(57600);
   while(!SerialUSB);
+  rtc.update();
   Serial.println(("Start at "+String(rtc.getMonth())+"/"+rtc.getDate()+"/"+rtc.getYear()+"  "+String(rtc.getHour())+":"+String(rtc.getMinute())));
   Serial.setTimeout(60000L);
 
@@ -26,11 +56,69 @@ void setup() {
 
 void loop() {
 
+  Serial.println("Send TYYYY-MM-DD HH:MM:SS to sync, or M to set the clock by hand");
+  String line = Serial.readStringUntil('\n');
+  line.trim();
+  if (line.startsWith("T")) {
+    doSync(line.c_str() + 1);
+  } else if (line.startsWith("M")) {
+    doManual();
+  }
+
+}
+
+
+/**
+ * Set the clock from a host's "YYYY-MM-DD HH:MM:SS" and measure the drift since the last sync
+ */
+void doSync(const char *when) {
+  int year, month, date, hour, minute, second;
+  if (sscanf(when, "%d-%d-%d %d:%d:%d", &year, &month, &date, &hour, &minute, &second) != 6 ||
+      year < 2000 || year > 2099 || month < 1 || month > 12 || date < 1 || date > 31) {
+    Serial.println("SYNC error");
+    return;
+  }
+  year -= 2000;
+  long days = daysSince2000(year, month, date);
+  long hostS = days * 86400L + hour * 3600L + minute * 60L + second;
+
+  //Where does the RTC think we are?
+  rtc.update();
+  long rtcS = daysSince2000(rtc.getYear(), rtc.getMonth(), rtc.getDate()) * 86400L +
+              rtc.getHour() * 3600L + rtc.getMinute() * 60L + rtc.getSecond();
+
+  //Measure the drift since the last sync.  Resetting the clock sooner would spoil the measurement.
+  long syncS;
+  long drift = rtcS - hostS;
+  EEPROM.get(EERTCSYNC, syncS);
+  long over = hostS - syncS;
+  if (syncS > 0L && over >= 0L && over < SYNCMINDAYS * 86400L) {
+    Serial.println("SYNC early drift="+String(drift));
+    return;
+  } else if (syncS > 0L && over > 0L) {
+    long ppm = drift * 10000L / (over / 100L);
+    EEPROM.put(EERTCPPM, ppm);
+    Serial.println("SYNC drift="+String(drift)+" over="+String(over)+" ppm="+String(ppm));
+  } else {
+    Serial.println("SYNC first");
+  }
+
+  //Set the clock and remember when.  2000-01-01 was a Saturday (day 7, counting Sunday as 1).
+  rtc.setTime(second, minute, hour, (days + 6) % 7 + 1, date, month, year);
+  EEPROM.put(EERTCSYNC, hostS);
+}
+
+
+/**
+ * Set the clock from fields typed by the user
+ */
+void doManual() {
+
   //Read the date
   Serial.println("Enter MM:DD:YYYY weekday#   ");
   byte month = Serial.parseInt();
   byte date = Serial.parseInt();
-  byte year = Serial.parseInt();
+  byte year = Serial.parseInt() % 100;
   byte day = Serial.parseInt();
 
   //Read the time
@@ -41,9 +129,11 @@ void loop() {
 
   //Set the date/time
   rtc.setTime(second, minute, hour, day, date, month, year);
+  long none = 0L;
+  EEPROM.put(EERTCSYNC, none);    //Too rough to measure drift from
 
   //Echo date/time from RTC
   Serial.println("RTC "+String(month)+"/"+String(date)+"/"+String(year)+"  "+String(hour)+":"+String(minute)+":"+String(second));
-  
+
 
 }